@@ -1,5 +1,11 @@
 #pragma once
 
+struct PendingTextureUpload
+{
+	VkBuffer buffer;
+	VkBufferImageCopy region;
+};
+
 class CachedTexture
 {
 public:
@@ -7,9 +13,39 @@ public:
 	std::unique_ptr<VulkanImageView> imageView;
 	VkImageLayout imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
-	int BindlessIndex[4] = { -1, -1, -1, -1 };
+	int BindlessIndex = -1;
 	int RealtimeChangeCount = 0;
 
-	std::vector<VkBufferImageCopy> pendingUploads[2];
+	// P8 texture uploaded as R8_UINT palette indexes
+	bool Paletted = false;
+	bool AlwaysMasked = false;
+	int PaletteRow = -1;
+	QWORD PaletteCacheID = 0;
+	int PaletteGeneration = 0;
+
+	// Only mip 0 is uploaded. The rest of the mip chain is built on the GPU with blits.
+	bool GenerateMips = false;
+
+	// Converted to BC1 or BC3 on upload
+	bool Compressed = false;
+
+	// First upload is written into the image from a worker thread with VK_EXT_host_image_copy
+	bool HostCopy = false;
+
+	// Mips below this level are still streaming in. Until they are resident the image view starts at this level.
+	int ResidentMip = 0;
+
+	// Hashes of the 16x16 tiles of mip 0 as last uploaded. Lets realtime re-uploads skip the tiles that didn't change.
+	std::vector<uint64_t> TileHashes;
+
+	// Format and usage the image was created with. Used to find a match when the image is pooled for reuse.
+	VkFormat ImageFormat = VK_FORMAT_UNDEFINED;
+	VkFormat ViewFormat = VK_FORMAT_UNDEFINED;
+	VkImageUsageFlags ImageUsage = 0;
+
+	VkDeviceSize AllocatedBytes = 0;
+	uint64_t LastUsedFrame = 0;
+
+	std::vector<PendingTextureUpload> pendingUploads[2];
 	bool inPendingUploads = false;
 };
@@ -27,6 +27,22 @@ CommandBufferManager::CommandBufferManager(UVulkanRenderDevice* renderer) : rend
 		.DebugName("CommandPool")
 		.Create(renderer->Device.get());
 
+	if (renderer->Device->GraphicsTimeQueries)
+	{
+		TimestampQueries = QueryPoolBuilder()
+			.QueryType(VK_QUERY_TYPE_TIMESTAMP, 2)
+			.DebugName("TimestampQueries")
+			.Create(renderer->Device.get());
+
+		uint32_t validBits = renderer->Device->PhysicalDevice.QueueFamilies[renderer->Device->GraphicsFamily].timestampValidBits;
+		TimestampMask = validBits < 64 ? (1ULL << validBits) - 1 : ~0ULL;
+		TimestampPeriod = renderer->Device->PhysicalDevice.Properties.Properties.limits.timestampPeriod;
+	}
+
+	PresentWait =
+		renderer->Device->SupportsExtension(VK_KHR_PRESENT_ID_EXTENSION_NAME) && renderer->Device->EnabledFeatures.PresentId.presentId &&
+		renderer->Device->SupportsExtension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME) && renderer->Device->EnabledFeatures.PresentWait.presentWait;
+
 	FrameDeleteList = std::make_unique<DeleteList>();
 }
 
@@ -35,38 +51,48 @@ CommandBufferManager::~CommandBufferManager()
 	DeleteFrameObjects();
 }
 
-void CommandBufferManager::WaitForTransfer()
+bool CommandBufferManager::SubmitTransfer(VulkanFence* fence)
 {
-	renderer->Uploads->SubmitUploads();
-
-	if (TransferCommands)
-	{
-		TransferCommands->end();
+	if (!TransferCommands)
+		return false;
 
-		QueueSubmit()
-			.AddCommandBuffer(TransferCommands.get())
-			.Execute(renderer->Device.get(), renderer->Device.get()->GraphicsQueue, RenderFinishedFence.get());
+	TransferCommands->end();
 
-		vkWaitForFences(renderer->Device.get()->device, 1, &RenderFinishedFence->fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
-		vkResetFences(renderer->Device.get()->device, 1, &RenderFinishedFence->fence);
+	QueueSubmit()
+		.AddCommandBuffer(TransferCommands.get())
+		.Execute(renderer->Device.get(), renderer->Device.get()->GraphicsQueue, fence);
 
-		TransferCommands.reset();
-	}
+	// Draw commands submitted later in the frame are ordered after this by the barriers in the transfer commands
+	FrameDeleteList->commandBuffers.push_back(std::move(TransferCommands));
+	return true;
 }
 
 void CommandBufferManager::SubmitCommands(bool present, int presentWidth, int presentHeight, bool presentFullscreen)
 {
 	renderer->Uploads->SubmitUploads();
 
+	// The present pass is left out of the measurement as it may have to wait for the swap chain image
+	bool timed = DrawCommands && TimestampQueries;
+	if (timed)
+		DrawCommands->writeTimestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, TimestampQueries.get(), 1);
+
 	if (present)
 	{
-		if (SwapChain->Lost() || SwapChain->Width() != presentWidth || SwapChain->Height() != presentHeight || UsingVsync != renderer->UseVSync || UsingHdr != renderer->Hdr)
+		if (SwapChain->Lost() || SwapChain->Width() != presentWidth || SwapChain->Height() != presentHeight || UsingVsync != renderer->UseVSync || UsingHdr != renderer->Hdr || UsingMaxQueuedFrames != renderer->VkMaxQueuedFrames)
 		{
 			UsingVsync = renderer->UseVSync;
 			UsingHdr = renderer->Hdr;
+			UsingMaxQueuedFrames = renderer->VkMaxQueuedFrames;
+
+			// One image is on screen while the others are queued up for it
+			int imageCount = renderer->VkMaxQueuedFrames > 0 ? renderer->VkMaxQueuedFrames + 1 : (renderer->UseVSync ? 2 : 3);
+
 			renderer->Framebuffers->DestroySwapChainFramebuffers();
-			SwapChain->Create(presentWidth, presentHeight, renderer->UseVSync ? 2 : 3, renderer->UseVSync, renderer->Hdr, renderer->VkExclusiveFullscreen && presentFullscreen);
+			SwapChain->Create(presentWidth, presentHeight, imageCount, renderer->UseVSync, renderer->Hdr, renderer->VkExclusiveFullscreen && presentFullscreen);
 			renderer->Framebuffers->CreateSwapChainFramebuffers();
+
+			// Earlier present ids belong to the old swap chain and can't be waited for anymore
+			SwapChainFirstPresentId = PresentCount + 1;
 		}
 
 		PresentImageIndex = SwapChain->AcquireImage(ImageAvailableSemaphore.get());
@@ -107,15 +133,45 @@ void CommandBufferManager::SubmitCommands(bool present, int presentWidth, int pr
 
 	if (present && PresentImageIndex != -1)
 	{
-		SwapChain->QueuePresent(PresentImageIndex, RenderFinishedSemaphore.get());
+		uint64_t presentId = (PresentWait && renderer->VkPresentWait) ? ++PresentCount : 0;
+		SwapChain->QueuePresent(PresentImageIndex, RenderFinishedSemaphore.get(), presentId);
 	}
 
 	vkWaitForFences(renderer->Device.get()->device, 1, &RenderFinishedFence->fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
 	vkResetFences(renderer->Device.get()->device, 1, &RenderFinishedFence->fence);
 
+	if (timed)
+	{
+		// A frame split by mid-frame submits is measured in parts
+		uint64_t timestamps[2] = {};
+		if (TimestampQueries->getResults(0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT))
+			FrameGpuTime += ((timestamps[1] - timestamps[0]) & TimestampMask) * TimestampPeriod / 1000000.0;
+	}
+	if (present)
+	{
+		LastFrameGpuTime = FrameGpuTime;
+		FrameGpuTime = 0.0;
+	}
+
 	DrawCommands.reset();
 	TransferCommands.reset();
 	DeleteFrameObjects();
+	renderer->DescriptorSets->RecycleTextureArrayIndexes();
+	renderer->Uploads->UploadsFinished(present);
+}
+
+bool CommandBufferManager::WaitForPresentQueue(int maxQueuedFrames)
+{
+	if (!PresentWait || PresentCount == 0)
+		return false;
+
+	uint64_t queued = (uint64_t)std::max(maxQueuedFrames, 1);
+	if (PresentCount < SwapChainFirstPresentId + queued - 1)
+		return false;
+
+	// A window that isn't visible may never display anything. Don't let that hang the game.
+	bool displayed = SwapChain->WaitForPresent(PresentCount - (queued - 1), 100'000'000);
+	return displayed && queued == 1;
 }
 
 VulkanCommandBuffer* CommandBufferManager::GetTransferCommands()
@@ -134,6 +190,12 @@ VulkanCommandBuffer* CommandBufferManager::GetDrawCommands()
 	{
 		DrawCommands = CommandPool->createBuffer();
 		DrawCommands->begin();
+
+		if (TimestampQueries)
+		{
+			DrawCommands->resetQueryPool(TimestampQueries.get(), 0, 2);
+			DrawCommands->writeTimestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, TimestampQueries.get(), 0);
+		}
 	}
 	return DrawCommands.get();
 }
@@ -8,18 +8,29 @@ public:
 	CommandBufferManager(UVulkanRenderDevice* renderer);
 	~CommandBufferManager();
 
-	void WaitForTransfer();
+	// Submits the transfer commands recorded so far without waiting for them. Returns false if there was nothing to submit.
+	bool SubmitTransfer(VulkanFence* fence);
 	void SubmitCommands(bool present, int presentWidth, int presentHeight, bool presentFullscreen);
 	VulkanCommandBuffer* GetTransferCommands();
 	VulkanCommandBuffer* GetDrawCommands();
 	void DeleteFrameObjects();
 
+	// GPU time of the draw commands of the last presented frame in milliseconds, measured with timestamp queries
+	bool HasGpuTimer() const { return !!TimestampQueries; }
+	double GetLastFrameGpuTime() const { return LastFrameGpuTime; }
+
+	// Waits until at most maxQueuedFrames presented frames have yet to reach the screen, using VK_KHR_present_wait.
+	// Returns true if it waited for the last presented frame to be displayed.
+	bool HasPresentWait() const { return PresentWait; }
+	bool WaitForPresentQueue(int maxQueuedFrames);
+
 	struct DeleteList
 	{
 		std::vector<std::unique_ptr<VulkanImage>> images;
 		std::vector<std::unique_ptr<VulkanImageView>> imageViews;
 		std::vector<std::unique_ptr<VulkanBuffer>> buffers;
 		std::vector<std::unique_ptr<VulkanDescriptorSet>> descriptors;
+		std::vector<std::unique_ptr<VulkanCommandBuffer>> commandBuffers;
 	};
 	std::unique_ptr<DeleteList> FrameDeleteList;
 
@@ -27,6 +38,7 @@ public:
 	int PresentImageIndex = -1;
 	BITFIELD UsingVsync = 0;
 	BITFIELD UsingHdr = 0;
+	int UsingMaxQueuedFrames = 0;
 
 private:
 	UVulkanRenderDevice* renderer = nullptr;
@@ -38,4 +50,14 @@ private:
 	std::unique_ptr<VulkanCommandPool> CommandPool;
 	std::unique_ptr<VulkanCommandBuffer> DrawCommands;
 	std::unique_ptr<VulkanCommandBuffer> TransferCommands;
+
+	std::unique_ptr<VulkanQueryPool> TimestampQueries;
+	uint64_t TimestampMask = 0;
+	double TimestampPeriod = 0.0;
+	double FrameGpuTime = 0.0;
+	double LastFrameGpuTime = 0.0;
+
+	bool PresentWait = false;
+	uint64_t PresentCount = 0;
+	uint64_t SwapChainFirstPresentId = 1;
 };
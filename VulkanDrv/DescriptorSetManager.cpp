@@ -7,6 +7,7 @@
 DescriptorSetManager::DescriptorSetManager(UVulkanRenderDevice* renderer) : renderer(renderer)
 {
 	CreateBindlessTextureSet();
+	UpdateSceneSamplers();
 	CreatePresentLayout();
 	CreatePresentSet();
 	CreateBloomLayout();
@@ -21,11 +22,13 @@ void DescriptorSetManager::ClearCache()
 {
 	Textures.WriteBindless = WriteDescriptors();
 	Textures.NextBindlessIndex = 0;
+	Textures.FreeBindlessIndexes.clear();
+	Textures.ReleasedBindlessIndexes.clear();
 }
 
 int DescriptorSetManager::GetTextureArrayIndex(DWORD PolyFlags, CachedTexture* tex, bool clamp)
 {
-	if (Textures.NextBindlessIndex == MaxBindlessTextures)
+	if (Textures.NextBindlessIndex == MaxBindlessTextures && Textures.FreeBindlessIndexes.empty())
 	{
 		static bool firstCall = true;
 		if (firstCall)
@@ -40,8 +43,10 @@ int DescriptorSetManager::GetTextureArrayIndex(DWORD PolyFlags, CachedTexture* t
 
 	if (Textures.NextBindlessIndex == 0)
 	{
-		Textures.WriteBindless.AddCombinedImageSampler(Textures.BindlessSet.get(), 0, 0, renderer->Textures->NullTextureView.get(), renderer->Samplers->Samplers[0].get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-		Textures.NextBindlessIndex = 1;
+		VulkanImageView* paletteAtlas = renderer->Textures->PaletteAtlas ? renderer->Textures->PaletteAtlas->imageView.get() : renderer->Textures->NullTextureView.get();
+		Textures.WriteBindless.AddSampledImage(Textures.BindlessSet.get(), 1, 0, renderer->Textures->NullTextureView.get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		Textures.WriteBindless.AddSampledImage(Textures.BindlessSet.get(), 1, PaletteAtlasIndex, paletteAtlas, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		Textures.NextBindlessIndex = PaletteAtlasIndex + 1;
 	}
 
 	if (!tex)
@@ -51,17 +56,53 @@ int DescriptorSetManager::GetTextureArrayIndex(DWORD PolyFlags, CachedTexture* t
 	if (PolyFlags & PF_NoSmooth) samplermode |= 1;
 	if (clamp) samplermode |= 2;
 
-	int index = tex->BindlessIndex[samplermode];
-	if (index != -1)
-		return index;
+	int index = tex->BindlessIndex;
+	if (index == -1)
+	{
+		if (!Textures.FreeBindlessIndexes.empty())
+		{
+			index = Textures.FreeBindlessIndexes.back();
+			Textures.FreeBindlessIndexes.pop_back();
+		}
+		else
+		{
+			index = Textures.NextBindlessIndex++;
+		}
+
+		Textures.WriteBindless.AddSampledImage(Textures.BindlessSet.get(), 1, index, tex->imageView.get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		tex->BindlessIndex = index;
+	}
 
-	index = Textures.NextBindlessIndex++;
+	int bind = index | (samplermode << BindlessSamplerShift);
+	if (tex->Paletted)
+	{
+		bind |= (tex->PaletteRow + 1) << BindlessPaletteShift;
+		if ((PolyFlags & PF_Masked) || tex->AlwaysMasked)
+			bind |= BindlessMaskedBit;
+	}
+	return bind;
+}
 
-	VulkanSampler* sampler = renderer->Samplers->Samplers[samplermode].get();
-	Textures.WriteBindless.AddCombinedImageSampler(Textures.BindlessSet.get(), 0, index, tex->imageView.get(), sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+void DescriptorSetManager::ReleaseTextureArrayIndex(CachedTexture* tex)
+{
+	if (tex->BindlessIndex > 0)
+		Textures.ReleasedBindlessIndexes.push_back(tex->BindlessIndex);
+	tex->BindlessIndex = -1;
+}
 
-	tex->BindlessIndex[samplermode] = index;
-	return index;
+void DescriptorSetManager::RecycleTextureArrayIndexes()
+{
+	Textures.FreeBindlessIndexes.insert(Textures.FreeBindlessIndexes.end(), Textures.ReleasedBindlessIndexes.begin(), Textures.ReleasedBindlessIndexes.end());
+	Textures.ReleasedBindlessIndexes.clear();
+}
+
+void DescriptorSetManager::UpdateSceneSamplers()
+{
+	WriteDescriptors write;
+	for (int i = 0; i < 4; i++)
+		write.AddSampler(Textures.BindlessSet.get(), 0, i, renderer->Samplers->Samplers[i].get());
+	write.Execute(renderer->Device.get());
 }
 
 void DescriptorSetManager::UpdateBindlessSet()
@@ -74,15 +115,17 @@ void DescriptorSetManager::CreateBindlessTextureSet()
 {
 	Textures.BindlessPool = DescriptorPoolBuilder()
 		.Flags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT)
-		.AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MaxBindlessTextures)
+		.AddPoolSize(VK_DESCRIPTOR_TYPE_SAMPLER, 4)
+		.AddPoolSize(VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, MaxBindlessTextures)
 		.MaxSets(MaxBindlessTextures)
 		.DebugName("TextureBindlessPool")
 		.Create(renderer->Device.get());
 
 	Textures.BindlessLayout = DescriptorSetLayoutBuilder()
 		.Flags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT)
+		.AddBinding(0, VK_DESCRIPTOR_TYPE_SAMPLER, 4, VK_SHADER_STAGE_FRAGMENT_BIT, VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT)
 		.AddBinding(
-			0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			1, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
 			MaxBindlessTextures,
 			VK_SHADER_STAGE_FRAGMENT_BIT,
 			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT)
@@ -114,8 +157,8 @@ void DescriptorSetManager::CreatePresentSet()
 void DescriptorSetManager::CreateBloomLayout()
 {
 	Bloom.Layout = DescriptorSetLayoutBuilder()
-		.AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT)
-		.AddBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT)
+		.AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT)
+		.AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT)
 		.DebugName("BloomLayout")
 		.Create(renderer->Device.get());
 }
@@ -123,33 +166,45 @@ void DescriptorSetManager::CreateBloomLayout()
 void DescriptorSetManager::CreateBloomSets()
 {
 	Bloom.Pool = DescriptorPoolBuilder()
-		.AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, (NumBloomLevels * 2 + 1) * 2)
-		.MaxSets(NumBloomLevels * 2 + 1)
+		.AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, NumBloomLevels * 2)
+		.AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, NumBloomLevels * 2)
+		.MaxSets(NumBloomLevels * 2)
 		.DebugName("BloomPool")
 		.Create(renderer->Device.get());
 
-	for (int level = 0; level < NumBloomLevels; level++)
-	{
-		Bloom.HTextureSets[level] = Bloom.Pool->allocate(Bloom.Layout.get());
-		Bloom.VTextureSets[level] = Bloom.Pool->allocate(Bloom.Layout.get());
-	}
-
-	Bloom.PPImageSet = Bloom.Pool->allocate(Bloom.Layout.get());
+	Bloom.ExtractSet = Bloom.Pool->allocate(Bloom.Layout.get());
+	for (int level = 1; level < NumBloomLevels; level++)
+		Bloom.DownsampleSets[level] = Bloom.Pool->allocate(Bloom.Layout.get());
+	for (int level = 0; level < NumBloomLevels - 1; level++)
+		Bloom.UpsampleSets[level] = Bloom.Pool->allocate(Bloom.Layout.get());
+	Bloom.CombineSet = Bloom.Pool->allocate(Bloom.Layout.get());
 }
 
 void DescriptorSetManager::UpdateFrameDescriptors()
 {
 	auto textures = renderer->Textures.get();
 	auto samplers = renderer->Samplers.get();
+	auto& levels = textures->Scene->BloomBlurLevels;
 
 	WriteDescriptors write;
-	write.AddCombinedImageSampler(Present.Set.get(), 0, textures->Scene->PPImageView[0].get(), samplers->PPLinearClamp.get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	write.AddCombinedImageSampler(Present.Set.get(), 0, textures->Scene->ResolvedColorBufferView, samplers->PPLinearClamp.get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 	write.AddCombinedImageSampler(Present.Set.get(), 1, textures->DitherImageView.get(), samplers->PPNearestRepeat.get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-	for (int level = 0; level < NumBloomLevels; level++)
+
+	write.AddCombinedImageSampler(Bloom.ExtractSet.get(), 0, textures->Scene->ResolvedColorBufferView, samplers->PPLinearClamp.get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	write.AddStorageImage(Bloom.ExtractSet.get(), 1, levels[0].VTextureView.get(), VK_IMAGE_LAYOUT_GENERAL);
+	for (int level = 1; level < NumBloomLevels; level++)
+	{
+		write.AddCombinedImageSampler(Bloom.DownsampleSets[level].get(), 0, levels[level - 1].VTextureView.get(), samplers->PPLinearClamp.get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		write.AddStorageImage(Bloom.DownsampleSets[level].get(), 1, levels[level].VTextureView.get(), VK_IMAGE_LAYOUT_GENERAL);
+	}
+	for (int level = 0; level < NumBloomLevels - 1; level++)
 	{
-		write.AddCombinedImageSampler(GetBloomHTextureSet(level), 0, textures->Scene->BloomBlurLevels[level].HTextureView.get(), samplers->PPLinearClamp.get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-		write.AddCombinedImageSampler(GetBloomVTextureSet(level), 0, textures->Scene->BloomBlurLevels[level].VTextureView.get(), samplers->PPLinearClamp.get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		VulkanImageView* input = (level + 1 == NumBloomLevels - 1) ? levels[level + 1].VTextureView.get() : levels[level + 1].HTextureView.get();
+		write.AddCombinedImageSampler(Bloom.UpsampleSets[level].get(), 0, input, samplers->PPLinearClamp.get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		write.AddStorageImage(Bloom.UpsampleSets[level].get(), 1, levels[level].HTextureView.get(), VK_IMAGE_LAYOUT_GENERAL);
 	}
-	write.AddCombinedImageSampler(Bloom.PPImageSet.get(), 0, textures->Scene->PPImageView[0].get(), samplers->PPLinearClamp.get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	VulkanImageView* combineInput = (NumBloomLevels > 1) ? levels[0].HTextureView.get() : levels[0].VTextureView.get();
+	write.AddCombinedImageSampler(Bloom.CombineSet.get(), 0, combineInput, samplers->PPLinearClamp.get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	write.AddStorageImage(Bloom.CombineSet.get(), 1, textures->Scene->ResolvedColorBufferView, VK_IMAGE_LAYOUT_GENERAL);
 	write.Execute(renderer->Device.get());
 }
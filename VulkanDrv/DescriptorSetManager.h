@@ -6,44 +6,6 @@
 class UVulkanRenderDevice;
 class CachedTexture;
 
-struct TexDescriptorKey
-{
-	TexDescriptorKey(CachedTexture* tex, CachedTexture* lightmap, CachedTexture* detailtex, CachedTexture* macrotex, uint32_t sampler) : tex(tex), lightmap(lightmap), detailtex(detailtex), macrotex(macrotex), sampler(sampler) { }
-
-	bool operator==(const TexDescriptorKey& other) const
-	{
-		return tex == other.tex && lightmap == other.lightmap && detailtex == other.detailtex && macrotex == other.macrotex && sampler == other.sampler;
-	}
-
-	bool operator<(const TexDescriptorKey& other) const
-	{
-		if (tex != other.tex)
-			return tex < other.tex;
-		else if (lightmap != other.lightmap)
-			return lightmap < other.lightmap;
-		else if (detailtex != other.detailtex)
-			return detailtex < other.detailtex;
-		else if (macrotex != other.macrotex)
-			return macrotex < other.macrotex;
-		else
-			return sampler < other.sampler;
-	}
-
-	CachedTexture* tex;
-	CachedTexture* lightmap;
-	CachedTexture* detailtex;
-	CachedTexture* macrotex;
-	uint32_t sampler;
-};
-
-template<> struct std::hash<TexDescriptorKey>
-{
-	std::size_t operator()(const TexDescriptorKey& k) const
-	{
-		return (((std::size_t)k.tex ^ (std::size_t)k.lightmap));
-	}
-};
-
 class DescriptorSetManager
 {
 public:
@@ -52,20 +14,34 @@ public:
 
 	void ClearCache();
 
-	bool IsTextureArrayFull() const { return Textures.NextBindlessIndex + 4 > MaxBindlessTextures; }
+	int GetTextureArrayUsed() const { return Textures.NextBindlessIndex - (int)Textures.FreeBindlessIndexes.size(); }
+	bool IsTextureArrayFull() const { return MaxBindlessTextures - Textures.NextBindlessIndex + (int)Textures.FreeBindlessIndexes.size() < 4; }
 	int GetTextureArrayIndex(DWORD PolyFlags, CachedTexture* tex, bool clamp = false);
+	void ReleaseTextureArrayIndex(CachedTexture* tex);
+	void RecycleTextureArrayIndexes();
+	void UpdateSceneSamplers();
 
 	VulkanDescriptorSet* GetBindlessSet() { return Textures.BindlessSet.get(); }
 	VulkanDescriptorSet* GetPresentSet() { return Present.Set.get(); }
-	VulkanDescriptorSet* GetBloomPPImageSet() { return Bloom.PPImageSet.get(); }
-	VulkanDescriptorSet* GetBloomVTextureSet(int level) { return Bloom.VTextureSets[level].get(); }
-	VulkanDescriptorSet* GetBloomHTextureSet(int level) { return Bloom.HTextureSets[level].get(); }
+	VulkanDescriptorSet* GetBloomExtractSet() { return Bloom.ExtractSet.get(); }
+	VulkanDescriptorSet* GetBloomDownsampleSet(int level) { return Bloom.DownsampleSets[level].get(); }
+	VulkanDescriptorSet* GetBloomUpsampleSet(int level) { return Bloom.UpsampleSets[level].get(); }
+	VulkanDescriptorSet* GetBloomCombineSet() { return Bloom.CombineSet.get(); }
 
 	void UpdateBindlessSet();
 	void UpdateFrameDescriptors();
 
 	static const int MaxBindlessTextures = 16536;
 
+	// Texture binding passed to the shader: bits 0-15 is the texture index, 16-17 the sampler index,
+	// 18-29 the palette atlas row plus one for palette index textures and bit 30 applies the masked rule to them.
+	static const int BindlessSamplerShift = 16;
+	static const int BindlessPaletteShift = 18;
+	static const int BindlessMaskedBit = 1 << 30;
+
+	// Texture index of the palette atlas (or the null texture when palette index textures are disabled)
+	static const int PaletteAtlasIndex = 1;
+
 	VulkanDescriptorSetLayout* GetTextureBindlessLayout() { return Textures.BindlessLayout.get(); }
 	VulkanDescriptorSetLayout* GetPresentLayout() { return Present.Layout.get(); }
 	VulkanDescriptorSetLayout* GetBloomLayout() { return Bloom.Layout.get(); }
@@ -86,6 +62,8 @@ private:
 		std::unique_ptr<VulkanDescriptorSet> BindlessSet;
 		WriteDescriptors WriteBindless;
 		int NextBindlessIndex = 0;
+		std::vector<int> FreeBindlessIndexes; // Slots that can be handed out again
+		std::vector<int> ReleasedBindlessIndexes; // Slots the GPU might still be reading from until the next submit completes
 
 	} Textures;
 
@@ -100,8 +78,9 @@ private:
 	{
 		std::unique_ptr<VulkanDescriptorSetLayout> Layout;
 		std::unique_ptr<VulkanDescriptorPool> Pool;
-		std::unique_ptr<VulkanDescriptorSet> VTextureSets[NumBloomLevels];
-		std::unique_ptr<VulkanDescriptorSet> HTextureSets[NumBloomLevels];
-		std::unique_ptr<VulkanDescriptorSet> PPImageSet;
+		std::unique_ptr<VulkanDescriptorSet> ExtractSet; // PPImage -> VTexture[0]
+		std::unique_ptr<VulkanDescriptorSet> DownsampleSets[NumBloomLevels]; // VTexture[level - 1] -> VTexture[level]
+		std::unique_ptr<VulkanDescriptorSet> UpsampleSets[NumBloomLevels]; // HTexture[level + 1] (or the last VTexture) -> HTexture[level]
+		std::unique_ptr<VulkanDescriptorSet> CombineSet; // HTexture[0] -> PPImage
 	} Bloom;
 };
@@ -0,0 +1,43 @@
+
+#include "Precomp.h"
+#include "DynamicResolution.h"
+
+namespace
+{
+	const float MinScale = 0.5f;
+	const float ScaleUpStep = 0.02f;
+
+	// A changed scale only shows up in the measurements a few frames later
+	const int SettleFrames = 4;
+}
+
+void DynamicResolution::Update(double gpuTime, double targetTime)
+{
+	// Smooth out single frame spikes while still reacting within a handful of frames when a big fight starts
+	AverageGpuTime = (AverageGpuTime == 0.0) ? gpuTime : AverageGpuTime * 0.8 + gpuTime * 0.2;
+
+	if (++FramesSinceChange < SettleFrames)
+		return;
+
+	// The GPU time roughly follows the pixel count, which goes with the square of the scale.
+	// Go down straight to the estimated scale, but only come back up in small steps so that it doesn't oscillate.
+	float newScale = Scale;
+	if (AverageGpuTime > targetTime * 0.95)
+		newScale = Scale * (float)std::sqrt(targetTime * 0.9 / AverageGpuTime);
+	else if (AverageGpuTime < targetTime * 0.75)
+		newScale = Scale + ScaleUpStep;
+	newScale = std::max(std::min(newScale, 1.0f), MinScale);
+
+	if (std::abs(newScale - Scale) >= 0.01f || (newScale == 1.0f && Scale != 1.0f))
+	{
+		Scale = newScale;
+		FramesSinceChange = 0;
+	}
+}
+
+void DynamicResolution::Reset()
+{
+	Scale = 1.0f;
+	AverageGpuTime = 0.0;
+	FramesSinceChange = 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+// Picks the resolution scale for the world from the measured GPU frame time
+class DynamicResolution
+{
+public:
+	// Feeds the GPU time of the last frame and the time it should stay below, both in milliseconds
+	void Update(double gpuTime, double targetTime);
+	void Reset();
+
+	float GetScale() const { return Scale; }
+	double GetAverageGpuTime() const { return AverageGpuTime; }
+
+private:
+	float Scale = 1.0f;
+	double AverageGpuTime = 0.0;
+	int FramesSinceChange = 0;
+};
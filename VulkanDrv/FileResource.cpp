@@ -53,7 +53,9 @@ std::string FileResource::readAllText(const std::string& filename)
 	else if (filename == "shaders/Scene.frag")
 	{
 		return R"(
-			layout(binding = 0) uniform sampler2D textures[];
+			layout(binding = 0) uniform sampler samplers[4];
+			layout(binding = 1) uniform texture2D textures[];
+			layout(binding = 1) uniform utexture2D utextures[]; // Palette index textures
 
 			layout(location = 0) flat in uint flags;
 			layout(location = 1) centroid in vec2 texCoord;
@@ -74,10 +76,70 @@ std::string FileResource::readAllText(const std::string& filename)
 				return vec4(clamp((c.rgb - cutoff) / (1.0 - cutoff), 0.0, 1.0), c.a);
 			}
 
-			vec4 textureTex(vec2 uv) { return texture(textures[nonuniformEXT(textureBinds.x)], uv); }
-			vec4 textureMacro(vec2 uv) { return texture(textures[nonuniformEXT(textureBinds.y)], uv); }
-			vec4 textureDetail(vec2 uv) { return texture(textures[nonuniformEXT(textureBinds.z)], uv); }
-			vec4 textureLightmap(vec2 uv) { return texture(textures[nonuniformEXT(textureBinds.w)], uv); }
+			vec4 paletteLookup(uint index, int paletteRow, bool masked)
+			{
+				if (masked && index == 0u)
+					return vec4(0.0);
+				return texelFetch(sampler2D(textures[1], samplers[1]), ivec2(index, paletteRow), 0);
+			}
+
+			ivec2 wrapTexel(ivec2 pos, ivec2 size, bool clampUV)
+			{
+				if (clampUV)
+					return clamp(pos, ivec2(0), size - 1);
+				else
+					return pos - size * ivec2(floor(vec2(pos) / vec2(size)));
+			}
+
+			vec4 texturePaletted(int bind, vec2 uv)
+			{
+				int index = bind & 0xffff;
+				bool nearest = (bind & (1 << 16)) != 0;
+				bool clampUV = (bind & (2 << 16)) != 0;
+				int paletteRow = ((bind >> 18) & 0xfff) - 1;
+				bool masked = (bind & (1 << 30)) != 0;
+
+				// Pick the nearest mip level
+				vec2 texelPos = uv * vec2(textureSize(usampler2D(utextures[nonuniformEXT(index)], samplers[1]), 0));
+				vec2 dx = dFdx(texelPos);
+				vec2 dy = dFdy(texelPos);
+				float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+				int level = clamp(int(lod + 0.5), 0, textureQueryLevels(usampler2D(utextures[nonuniformEXT(index)], samplers[1])) - 1);
+
+				ivec2 size = textureSize(usampler2D(utextures[nonuniformEXT(index)], samplers[1]), level);
+				vec2 pos = uv * vec2(size);
+
+				if (nearest)
+				{
+					ivec2 p = wrapTexel(ivec2(floor(pos)), size, clampUV);
+					return paletteLookup(texelFetch(usampler2D(utextures[nonuniformEXT(index)], samplers[1]), p, level).r, paletteRow, masked);
+				}
+
+				// Integer textures can't be filtered by the hardware. Filter the palette colors instead.
+				pos -= 0.5;
+				ivec2 p0 = ivec2(floor(pos));
+				vec2 t = pos - vec2(p0);
+				ivec2 p00 = wrapTexel(p0, size, clampUV);
+				ivec2 p11 = wrapTexel(p0 + 1, size, clampUV);
+				vec4 c00 = paletteLookup(texelFetch(usampler2D(utextures[nonuniformEXT(index)], samplers[1]), ivec2(p00.x, p00.y), level).r, paletteRow, masked);
+				vec4 c10 = paletteLookup(texelFetch(usampler2D(utextures[nonuniformEXT(index)], samplers[1]), ivec2(p11.x, p00.y), level).r, paletteRow, masked);
+				vec4 c01 = paletteLookup(texelFetch(usampler2D(utextures[nonuniformEXT(index)], samplers[1]), ivec2(p00.x, p11.y), level).r, paletteRow, masked);
+				vec4 c11 = paletteLookup(texelFetch(usampler2D(utextures[nonuniformEXT(index)], samplers[1]), ivec2(p11.x, p11.y), level).r, paletteRow, masked);
+				return mix(mix(c00, c10, t.x), mix(c01, c11, t.x), t.y);
+			}
+
+			// Bits 0-15 is the texture index, 16-17 the sampler index, 18-29 the palette row plus one and bit 30 the masked rule
+			vec4 textureBindless(int bind, vec2 uv)
+			{
+				if ((bind & (0xfff << 18)) != 0)
+					return texturePaletted(bind, uv);
+				return texture(sampler2D(textures[nonuniformEXT(bind & 0xffff)], samplers[nonuniformEXT((bind >> 16) & 3)]), uv);
+			}
+
+			vec4 textureTex(vec2 uv) { return textureBindless(textureBinds.x, uv); }
+			vec4 textureMacro(vec2 uv) { return textureBindless(textureBinds.y, uv); }
+			vec4 textureDetail(vec2 uv) { return textureBindless(textureBinds.z, uv); }
+			vec4 textureLightmap(vec2 uv) { return textureBindless(textureBinds.w, uv); }
 
 			void main()
 			{
@@ -267,95 +329,106 @@ std::string FileResource::readAllText(const std::string& filename)
 			}
 		)";
 	}
-	else if (filename == "shaders/BloomExtract.frag")
+	else if (filename == "shaders/BloomDownsample.comp")
 	{
 		return R"(
-			layout(push_constant) uniform BloomPushConstants
-			{
-				float SampleWeights0;
-				float SampleWeights1;
-				float SampleWeights2;
-				float SampleWeights3;
-				float SampleWeights4;
-				float SampleWeights5;
-				float SampleWeights6;
-				float SampleWeights7;
-			};
+			layout(local_size_x = 8, local_size_y = 8) in;
 
-			layout(binding = 0) uniform sampler2D texSampler;
-			layout(location = 0) in vec2 texCoord;
-			layout(location = 0) out vec4 outColor;
+			layout(binding = 0) uniform sampler2D inputTexture;
+			layout(binding = 1, rgba16f) uniform writeonly image2D outputImage;
 
-			void main()
+			// Each work group outputs 8x8 pixels from a 16x16 source block plus a one texel border
+			shared vec3 tile[18][18];
+
+			vec3 loadTexel(ivec2 pos)
 			{
-				outColor = vec4(max(texture(texSampler, texCoord).rgb - 1.0, 0.0), 0.0);
+				ivec2 size = textureSize(inputTexture, 0);
+				vec3 color = texelFetch(inputTexture, clamp(pos, ivec2(0), size - 1), 0).rgb;
+			#if defined(BLOOM_EXTRACT)
+				color = max(color - 1.0, vec3(0.0));
+			#endif
+				return color;
 			}
-		)";
-	}
-	else if (filename == "shaders/BloomCombine.frag")
-	{
-		return R"(
-			layout(push_constant) uniform BloomPushConstants
-			{
-				float SampleWeights0;
-				float SampleWeights1;
-				float SampleWeights2;
-				float SampleWeights3;
-				float SampleWeights4;
-				float SampleWeights5;
-				float SampleWeights6;
-				float SampleWeights7;
-			};
 
-			layout(binding = 0) uniform sampler2D texSampler;
-			layout(location = 0) in vec2 texCoord;
-			layout(location = 0) out vec4 outColor;
+			vec3 box(ivec2 pos)
+			{
+				return (tile[pos.y][pos.x] + tile[pos.y][pos.x + 1] + tile[pos.y + 1][pos.x] + tile[pos.y + 1][pos.x + 1]) * 0.25;
+			}
 
 			void main()
 			{
-				outColor = texture(texSampler, texCoord);
+				ivec2 tileOrigin = ivec2(gl_WorkGroupID.xy) * 16 - 1;
+				for (uint i = gl_LocalInvocationIndex; i < 18 * 18; i += 64)
+				{
+					ivec2 pos = ivec2(i % 18, i / 18);
+					tile[pos.y][pos.x] = loadTexel(tileOrigin + pos);
+				}
+				barrier();
+
+				ivec2 outPos = ivec2(gl_GlobalInvocationID.xy);
+				if (any(greaterThanEqual(outPos, imageSize(outputImage))))
+					return;
+
+				// Dual filter downsample: center box weighted 4 plus the four diagonal boxes
+				ivec2 center = ivec2(gl_LocalInvocationID.xy) * 2 + 1;
+				vec3 color =
+					box(center) * 0.5 +
+					(box(center + ivec2(-1, -1)) +
+					 box(center + ivec2( 1, -1)) +
+					 box(center + ivec2(-1,  1)) +
+					 box(center + ivec2( 1,  1))) * 0.125;
+
+				imageStore(outputImage, outPos, vec4(color, 0.0));
 			}
 		)";
 	}
-	else if (filename == "shaders/Blur.frag")
+	else if (filename == "shaders/BloomUpsample.comp")
 	{
 		return R"(
+			layout(local_size_x = 8, local_size_y = 8) in;
+
 			layout(push_constant) uniform BloomPushConstants
 			{
-				float SampleWeights0;
-				float SampleWeights1;
-				float SampleWeights2;
-				float SampleWeights3;
-				float SampleWeights4;
-				float SampleWeights5;
-				float SampleWeights6;
-				float SampleWeights7;
+				float Offset;
+				float Intensity;
+				float Padding0;
+				float Padding1;
 			};
 
-			layout(binding = 0) uniform sampler2D texSampler;
-			layout(location = 0) in vec2 texCoord;
-			layout(location = 0) out vec4 outColor;
+			layout(binding = 0) uniform sampler2D inputTexture;
+			#if defined(BLOOM_COMBINE)
+			layout(binding = 1, rgba16f) uniform image2D outputImage;
+			#else
+			layout(binding = 1, rgba16f) uniform writeonly image2D outputImage;
+			#endif
 
 			void main()
 			{
-			#if defined(BLUR_HORIZONTAL)
-				outColor =
-					textureOffset(texSampler, texCoord, ivec2( 0, 0)) * SampleWeights0 +
-					textureOffset(texSampler, texCoord, ivec2( 1, 0)) * SampleWeights1 +
-					textureOffset(texSampler, texCoord, ivec2(-1, 0)) * SampleWeights2 +
-					textureOffset(texSampler, texCoord, ivec2( 2, 0)) * SampleWeights3 +
-					textureOffset(texSampler, texCoord, ivec2(-2, 0)) * SampleWeights4 +
-					textureOffset(texSampler, texCoord, ivec2( 3, 0)) * SampleWeights5 +
-					textureOffset(texSampler, texCoord, ivec2(-3, 0)) * SampleWeights6;
+				ivec2 outPos = ivec2(gl_GlobalInvocationID.xy);
+				ivec2 outSize = imageSize(outputImage);
+				if (any(greaterThanEqual(outPos, outSize)))
+					return;
+
+				vec2 uv = (vec2(outPos) + 0.5) / vec2(outSize);
+				vec2 hp = (0.5 * Offset) / vec2(textureSize(inputTexture, 0));
+
+				// Dual filter upsample tent
+				vec3 color =
+					textureLod(inputTexture, uv + vec2(-hp.x * 2.0, 0.0), 0.0).rgb +
+					textureLod(inputTexture, uv + vec2(-hp.x, hp.y), 0.0).rgb * 2.0 +
+					textureLod(inputTexture, uv + vec2(0.0, hp.y * 2.0), 0.0).rgb +
+					textureLod(inputTexture, uv + vec2(hp.x, hp.y), 0.0).rgb * 2.0 +
+					textureLod(inputTexture, uv + vec2(hp.x * 2.0, 0.0), 0.0).rgb +
+					textureLod(inputTexture, uv + vec2(hp.x, -hp.y), 0.0).rgb * 2.0 +
+					textureLod(inputTexture, uv + vec2(0.0, -hp.y * 2.0), 0.0).rgb +
+					textureLod(inputTexture, uv + vec2(-hp.x, -hp.y), 0.0).rgb * 2.0;
+				color *= 1.0 / 12.0;
+
+			#if defined(BLOOM_COMBINE)
+				vec4 scene = imageLoad(outputImage, outPos);
+				imageStore(outputImage, outPos, vec4(scene.rgb + color * Intensity, scene.a));
 			#else
-				outColor =
-					textureOffset(texSampler, texCoord, ivec2(0, 0)) * SampleWeights0 +
-					textureOffset(texSampler, texCoord, ivec2(0, 1)) * SampleWeights1 +
-					textureOffset(texSampler, texCoord, ivec2(0,-1)) * SampleWeights2 +
-					textureOffset(texSampler, texCoord, ivec2(0, 2)) * SampleWeights3 +
-					textureOffset(texSampler, texCoord, ivec2(0,-2)) * SampleWeights4 +
-					textureOffset(texSampler, texCoord, ivec2(0, 3)) * SampleWeights5 +
-					textureOffset(texSampler, texCoord, ivec2(0,-3)) * SampleWeights6;
+				imageStore(outputImage, outPos, vec4(color, 0.0));
 			#endif
 			}
 		)";
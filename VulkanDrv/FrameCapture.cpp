@@ -0,0 +1,327 @@
+
+#include "Precomp.h"
+#include "FrameCapture.h"
+#include "UVulkanRenderDevice.h"
+
+FrameCapture::FrameCapture(UVulkanRenderDevice* renderer, const std::string& directory, int width, int height, int fps, CaptureFormat format) : renderer(renderer), Directory(directory), Width(width), Height(height), FPS(fps), Format(format)
+{
+	ConvertImage = ImageBuilder()
+		.Format(VK_FORMAT_B8G8R8A8_UNORM)
+		.Usage(VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+		.Size(Width, Height)
+		.DebugName("CaptureConvertImage")
+		.Create(renderer->Device.get());
+
+	for (int i = 0; i < NumSlots; i++)
+	{
+		Slots[i].Buffer = BufferBuilder()
+			.Size(Width * Height * 4)
+			.Usage(VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU)
+			.DebugName("CaptureReadbackBuffer")
+			.Create(renderer->Device.get());
+
+		// The buffers stay mapped for the lifetime of the capture so the writer thread can read them directly
+		Slots[i].Pixels = (const uint8_t*)Slots[i].Buffer->Map(0, Width * Height * 4);
+	}
+
+	if (Format == CaptureFormat::Y4M)
+	{
+		std::string filename = Directory + "/capture.y4m";
+		StreamFile = fopen(filename.c_str(), "wb");
+		if (!StreamFile)
+			VulkanError(("Could not create " + filename).c_str());
+
+		std::string header = "YUV4MPEG2 W" + std::to_string(Width) + " H" + std::to_string(Height) + " F" + std::to_string(FPS) + ":1 Ip A1:1 C420jpeg\n";
+		fwrite(header.data(), header.size(), 1, StreamFile);
+	}
+
+	StartTime = std::chrono::steady_clock::now();
+	Writer = std::thread([this]() { WriterMain(); });
+}
+
+FrameCapture::~FrameCapture()
+{
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		StopWriter = true;
+	}
+	Condition.notify_all();
+	Writer.join();
+
+	if (StreamFile)
+		fclose(StreamFile);
+
+	for (int i = 0; i < NumSlots; i++)
+	{
+		Slots[i].Buffer->Unmap();
+	}
+}
+
+void FrameCapture::RecordFrame(VulkanCommandBuffer* cmdbuffer)
+{
+	// How many capture frames should have been emitted by now?
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+	int64_t targetFrames = (int64_t)(elapsed * FPS) + 1;
+	int repeat = (int)std::min(targetFrames - FramesRecorded, (int64_t)FPS);
+	if (repeat <= 0)
+		return;
+
+	// Grab a free slot. If the writer thread is still busy with all of them we drop the frame rather than stalling.
+	int slot = -1;
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		for (int i = 0; i < NumSlots; i++)
+		{
+			if (!Slots[i].InUse)
+			{
+				slot = i;
+				Slots[i].InUse = true;
+				break;
+			}
+		}
+	}
+
+	FramesRecorded = targetFrames;
+
+	if (slot == -1)
+	{
+		FramesDropped += repeat;
+		return;
+	}
+
+	Slots[slot].Repeat = repeat;
+	renderer->CopyPostprocessToBuffer(cmdbuffer, ConvertImage.get(), Slots[slot].Buffer.get());
+	RecordedSlot = slot;
+}
+
+void FrameCapture::FrameSubmitted()
+{
+	if (RecordedSlot == -1)
+		return;
+
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		WriteQueue.push_back(RecordedSlot);
+	}
+	Condition.notify_one();
+	RecordedSlot = -1;
+}
+
+void FrameCapture::WriterMain()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	while (true)
+	{
+		Condition.wait(lock, [&]() { return StopWriter || !WriteQueue.empty(); });
+		if (WriteQueue.empty())
+			break;
+
+		int slot = WriteQueue.front();
+		WriteQueue.erase(WriteQueue.begin());
+
+		lock.unlock();
+		WriteFrame(Slots[slot].Pixels, Slots[slot].Repeat);
+		lock.lock();
+
+		Slots[slot].InUse = false;
+	}
+}
+
+void FrameCapture::WriteFrame(const uint8_t* pixels, int repeat)
+{
+	for (int i = 0; i < repeat; i++)
+	{
+		switch (Format)
+		{
+		case CaptureFormat::Raw: WriteRaw(pixels); break;
+		case CaptureFormat::PNG: WritePNG(pixels); break;
+		case CaptureFormat::Y4M: WriteY4M(pixels); break;
+		}
+		FramesWritten++;
+	}
+}
+
+std::string FrameCapture::GetFrameFilename(const char* extension) const
+{
+	char name[64];
+	snprintf(name, sizeof(name), "/frame%06d.%s", (int)FramesWritten, extension);
+	return Directory + name;
+}
+
+void FrameCapture::WriteRaw(const uint8_t* pixels)
+{
+	FILE* file = fopen(GetFrameFilename("bgra").c_str(), "wb");
+	if (file)
+	{
+		fwrite(pixels, Width * Height * 4, 1, file);
+		fclose(file);
+	}
+}
+
+static uint32_t PNGCrc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+	static uint32_t table[256];
+	static bool initialized = false;
+	if (!initialized)
+	{
+		for (uint32_t n = 0; n < 256; n++)
+		{
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+		initialized = true;
+	}
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static void PNGWriteUInt32(std::vector<uint8_t>& out, uint32_t value)
+{
+	out.push_back((uint8_t)(value >> 24));
+	out.push_back((uint8_t)(value >> 16));
+	out.push_back((uint8_t)(value >> 8));
+	out.push_back((uint8_t)value);
+}
+
+static void PNGWriteChunk(FILE* file, const char* type, const std::vector<uint8_t>& data)
+{
+	std::vector<uint8_t> header;
+	PNGWriteUInt32(header, (uint32_t)data.size());
+	header.insert(header.end(), type, type + 4);
+
+	uint32_t crc = PNGCrc32(0, header.data() + 4, 4);
+	crc = PNGCrc32(crc, data.data(), data.size());
+
+	std::vector<uint8_t> footer;
+	PNGWriteUInt32(footer, crc);
+
+	fwrite(header.data(), header.size(), 1, file);
+	if (!data.empty())
+		fwrite(data.data(), data.size(), 1, file);
+	fwrite(footer.data(), footer.size(), 1, file);
+}
+
+void FrameCapture::WritePNG(const uint8_t* pixels)
+{
+	FILE* file = fopen(GetFrameFilename("png").c_str(), "wb");
+	if (!file)
+		return;
+
+	static const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	fwrite(signature, 8, 1, file);
+
+	std::vector<uint8_t> ihdr;
+	PNGWriteUInt32(ihdr, Width);
+	PNGWriteUInt32(ihdr, Height);
+	ihdr.push_back(8); // bit depth
+	ihdr.push_back(2); // color type: RGB
+	ihdr.push_back(0); // compression
+	ihdr.push_back(0); // filter
+	ihdr.push_back(0); // interlace
+	PNGWriteChunk(file, "IHDR", ihdr);
+
+	// Filtered scanlines: one filter type byte followed by RGB
+	size_t pitch = (size_t)Width * 3 + 1;
+	EncodeBuffer.resize(pitch * Height);
+	for (int y = 0; y < Height; y++)
+	{
+		const uint8_t* src = pixels + (size_t)y * Width * 4;
+		uint8_t* dst = EncodeBuffer.data() + y * pitch;
+		*(dst++) = 0;
+		for (int x = 0; x < Width; x++)
+		{
+			dst[0] = src[2];
+			dst[1] = src[1];
+			dst[2] = src[0];
+			dst += 3;
+			src += 4;
+		}
+	}
+
+	// Encoding speed matters more than size here, so the zlib stream only uses stored (uncompressed) deflate blocks
+	std::vector<uint8_t> idat;
+	idat.reserve(EncodeBuffer.size() + EncodeBuffer.size() / 65535 * 5 + 16);
+	idat.push_back(0x78);
+	idat.push_back(0x01);
+	size_t pos = 0;
+	do
+	{
+		uint16_t blocksize = (uint16_t)std::min(EncodeBuffer.size() - pos, (size_t)65535);
+		bool last = pos + blocksize == EncodeBuffer.size();
+		idat.push_back(last ? 1 : 0);
+		idat.push_back(blocksize & 0xff);
+		idat.push_back(blocksize >> 8);
+		idat.push_back(~blocksize & 0xff);
+		idat.push_back((~blocksize >> 8) & 0xff);
+		idat.insert(idat.end(), EncodeBuffer.begin() + pos, EncodeBuffer.begin() + pos + blocksize);
+		pos += blocksize;
+	} while (pos < EncodeBuffer.size());
+
+	uint32_t a = 1, b = 0;
+	for (uint8_t value : EncodeBuffer)
+	{
+		a = (a + value) % 65521;
+		b = (b + a) % 65521;
+	}
+	PNGWriteUInt32(idat, (b << 16) | a);
+	PNGWriteChunk(file, "IDAT", idat);
+
+	PNGWriteChunk(file, "IEND", {});
+	fclose(file);
+}
+
+void FrameCapture::WriteY4M(const uint8_t* pixels)
+{
+	// Full range BT.601 (C420jpeg) with 2x2 chroma subsampling
+	int chromaWidth = (Width + 1) / 2;
+	int chromaHeight = (Height + 1) / 2;
+	size_t lumaSize = (size_t)Width * Height;
+	size_t chromaSize = (size_t)chromaWidth * chromaHeight;
+	EncodeBuffer.resize(lumaSize + chromaSize * 2);
+
+	uint8_t* yplane = EncodeBuffer.data();
+	uint8_t* uplane = yplane + lumaSize;
+	uint8_t* vplane = uplane + chromaSize;
+
+	for (int y = 0; y < Height; y++)
+	{
+		const uint8_t* src = pixels + (size_t)y * Width * 4;
+		for (int x = 0; x < Width; x++)
+		{
+			int b = src[x * 4], g = src[x * 4 + 1], r = src[x * 4 + 2];
+			yplane[y * Width + x] = (uint8_t)std::min((19595 * r + 38470 * g + 7471 * b + 32768) >> 16, 255);
+		}
+	}
+
+	for (int cy = 0; cy < chromaHeight; cy++)
+	{
+		for (int cx = 0; cx < chromaWidth; cx++)
+		{
+			int r = 0, g = 0, b = 0, count = 0;
+			for (int y = cy * 2; y < std::min(cy * 2 + 2, Height); y++)
+			{
+				for (int x = cx * 2; x < std::min(cx * 2 + 2, Width); x++)
+				{
+					const uint8_t* src = pixels + ((size_t)y * Width + x) * 4;
+					b += src[0];
+					g += src[1];
+					r += src[2];
+					count++;
+				}
+			}
+			r /= count;
+			g /= count;
+			b /= count;
+			uplane[cy * chromaWidth + cx] = (uint8_t)std::max(std::min((-11059 * r - 21709 * g + 32768 * b + 8421376) >> 16, 255), 0);
+			vplane[cy * chromaWidth + cx] = (uint8_t)std::max(std::min((32768 * r - 27439 * g - 5329 * b + 8421376) >> 16, 255), 0);
+		}
+	}
+
+	fwrite("FRAME\n", 6, 1, StreamFile);
+	fwrite(EncodeBuffer.data(), EncodeBuffer.size(), 1, StreamFile);
+}
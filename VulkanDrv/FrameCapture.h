@@ -0,0 +1,77 @@
+#pragma once
+
+#include <thread>
+#include <condition_variable>
+#include <string>
+#include <chrono>
+#include <atomic>
+
+class UVulkanRenderDevice;
+
+enum class CaptureFormat
+{
+	Raw,
+	PNG,
+	Y4M
+};
+
+class FrameCapture
+{
+public:
+	FrameCapture(UVulkanRenderDevice* renderer, const std::string& directory, int width, int height, int fps, CaptureFormat format);
+	~FrameCapture();
+
+	// Called before the frame is submitted. Records a readback of the postprocess output into a free ring slot if a capture frame is due.
+	void RecordFrame(VulkanCommandBuffer* cmdbuffer);
+
+	// Called once the GPU finished the commands recorded in RecordFrame. Hands the slot to the writer thread.
+	void FrameSubmitted();
+
+	int GetWidth() const { return Width; }
+	int GetHeight() const { return Height; }
+	int GetFramesWritten() const { return FramesWritten; }
+	int GetFramesDropped() const { return FramesDropped; }
+
+private:
+	enum { NumSlots = 3 };
+
+	struct Slot
+	{
+		std::unique_ptr<VulkanBuffer> Buffer;
+		const uint8_t* Pixels = nullptr;
+		int Repeat = 0;
+		bool InUse = false;
+	};
+
+	void WriterMain();
+	void WriteFrame(const uint8_t* pixels, int repeat);
+	void WriteRaw(const uint8_t* pixels);
+	void WritePNG(const uint8_t* pixels);
+	void WriteY4M(const uint8_t* pixels);
+	std::string GetFrameFilename(const char* extension) const;
+
+	UVulkanRenderDevice* renderer = nullptr;
+
+	std::string Directory;
+	int Width = 0;
+	int Height = 0;
+	int FPS = 0;
+	CaptureFormat Format = CaptureFormat::PNG;
+
+	std::unique_ptr<VulkanImage> ConvertImage;
+	Slot Slots[NumSlots];
+	int RecordedSlot = -1;
+
+	std::chrono::steady_clock::time_point StartTime;
+	int64_t FramesRecorded = 0;
+	int FramesDropped = 0;
+	std::atomic<int> FramesWritten{ 0 };
+	FILE* StreamFile = nullptr;
+	std::vector<uint8_t> EncodeBuffer;
+
+	std::thread Writer;
+	std::mutex Mutex;
+	std::condition_variable Condition;
+	std::vector<int> WriteQueue;
+	bool StopWriter = false;
+};
@@ -0,0 +1,68 @@
+
+#include "Precomp.h"
+#include "FramePacer.h"
+#include <thread>
+
+void FramePacer::FrameFinished()
+{
+	FrameEnd = Clock::now();
+	if (!Started)
+	{
+		FrameStart = FrameEnd;
+		Deadline = FrameEnd;
+		Started = true;
+	}
+
+	// Follow a slower frame right away, but only let the prediction drop slowly so that one quick frame doesn't make the next one late
+	double frameTime = std::chrono::duration<double>(FrameEnd - FrameStart).count();
+	PredictedFrameTime = std::max(frameTime, PredictedFrameTime * 0.95 + frameTime * 0.05);
+}
+
+void FramePacer::WaitForNextFrame(double interval, bool displayed)
+{
+	Clock::time_point now = Clock::now();
+	Clock::duration step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(interval));
+
+	// Start over from the current frame if it was on screen just now or if it missed its deadline by more than a whole interval
+	if (displayed || now - Deadline > step)
+		Deadline = now;
+	Deadline += step;
+
+	// Leave a little room for the scheduler and for frames that take a bit longer than predicted
+	Clock::duration margin = std::chrono::microseconds(500);
+	Clock::time_point start = Deadline - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(PredictedFrameTime)) - margin;
+	SleepUntil(start);
+
+	FrameStart = Clock::now();
+	LastSleepTime = std::chrono::duration<double>(FrameStart - now).count();
+}
+
+void FramePacer::Reset()
+{
+	Started = false;
+	PredictedFrameTime = 0.0;
+	LastSleepTime = 0.0;
+}
+
+void FramePacer::SleepUntil(Clock::time_point time)
+{
+	while (true)
+	{
+		Clock::time_point now = Clock::now();
+		if (now >= time)
+			break;
+
+		if (time - now > SleepOvershoot)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+			// Learn how coarse the OS timer is, but let a single late wakeup fade out again
+			Clock::duration slept = Clock::now() - now;
+			SleepOvershoot = std::max(slept, SleepOvershoot - SleepOvershoot / 64);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
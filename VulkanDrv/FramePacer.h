@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+
+// Frame rate limiter that sleeps before the next frame rather than after the current one. The game then samples input
+// as late as it can while the frame still gets done in time.
+class FramePacer
+{
+public:
+	// Called when the GPU is done with a frame that is to be presented
+	void FrameFinished();
+
+	// Sleeps until the next frame must start to be done one interval (in seconds) after the current one.
+	// displayed tells that the caller just waited for the current frame to reach the screen, which aligns the deadlines to the display.
+	void WaitForNextFrame(double interval, bool displayed);
+
+	// Forgets the timings, for when the limiter has been off for a while
+	void Reset();
+
+	// In milliseconds
+	double GetPredictedFrameTime() const { return PredictedFrameTime * 1000.0; }
+	double GetLastSleepTime() const { return LastSleepTime * 1000.0; }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	void SleepUntil(Clock::time_point time);
+
+	bool Started = false;
+	Clock::time_point FrameStart;
+	Clock::time_point FrameEnd;
+	Clock::time_point Deadline;
+	double PredictedFrameTime = 0.0;
+	double LastSleepTime = 0.0;
+
+	// How late a short sleep may wake up. The last stretch before the start time is spun rather than slept.
+	Clock::duration SleepOvershoot = std::chrono::milliseconds(2);
+};
@@ -9,30 +9,18 @@ FramebufferManager::FramebufferManager(UVulkanRenderDevice* renderer) : renderer
 
 void FramebufferManager::CreateSceneFramebuffer()
 {
-	SceneFramebuffer = FramebufferBuilder()
-		.RenderPass(renderer->RenderPasses->Scene.RenderPass.get())
-		.Size(renderer->Textures->Scene->Width, renderer->Textures->Scene->Height)
-		.AddAttachment(renderer->Textures->Scene->ColorBufferView.get())
-		.AddAttachment(renderer->Textures->Scene->HitBufferView.get())
-		.AddAttachment(renderer->Textures->Scene->DepthBufferView.get())
-		.DebugName("SceneFramebuffer")
-		.Create(renderer->Device.get());
-
-	for (int level = 0; level < NumBloomLevels; level++)
+	if (!renderer->UseDynamicRendering)
 	{
-		BloomBlurLevels[level].VTextureFB = FramebufferBuilder()
-			.RenderPass(renderer->RenderPasses->Postprocess.RenderPass.get())
-			.Size(renderer->Textures->Scene->BloomBlurLevels[level].Width, renderer->Textures->Scene->BloomBlurLevels[level].Height)
-			.AddAttachment(renderer->Textures->Scene->BloomBlurLevels[level].VTextureView.get())
-			.DebugName("VTextureFB")
-			.Create(renderer->Device.get());
-
-		BloomBlurLevels[level].HTextureFB = FramebufferBuilder()
-			.RenderPass(renderer->RenderPasses->Postprocess.RenderPass.get())
-			.Size(renderer->Textures->Scene->BloomBlurLevels[level].Width, renderer->Textures->Scene->BloomBlurLevels[level].Height)
-			.AddAttachment(renderer->Textures->Scene->BloomBlurLevels[level].HTextureView.get())
-			.DebugName("HTextureFB")
-			.Create(renderer->Device.get());
+		FramebufferBuilder builder;
+		builder.RenderPass(renderer->RenderPasses->Scene.RenderPass.get());
+		builder.Size(renderer->Textures->Scene->Width, renderer->Textures->Scene->Height);
+		builder.AddAttachment(renderer->Textures->Scene->ColorBufferView.get());
+		builder.AddAttachment(renderer->Textures->Scene->HitBufferView.get());
+		builder.AddAttachment(renderer->Textures->Scene->DepthBufferView.get());
+		if (renderer->Textures->Scene->SceneSamples != VK_SAMPLE_COUNT_1_BIT)
+			builder.AddAttachment(renderer->Textures->Scene->PPImageView[0].get());
+		builder.DebugName("SceneFramebuffer");
+		SceneFramebuffer = builder.Create(renderer->Device.get());
 	}
 
 	for (int i = 0; i < 2; i++)
@@ -49,12 +37,6 @@ void FramebufferManager::CreateSceneFramebuffer()
 void FramebufferManager::DestroySceneFramebuffer()
 {
 	SceneFramebuffer.reset();
-	for (int level = 0; level < NumBloomLevels; level++)
-	{
-		BloomBlurLevels[level].VTextureFB.reset();
-		BloomBlurLevels[level].HTextureFB.reset();
-	}
-
 	for (int i = 0; i < 2; i++)
 		PPImageFB[i].reset();
 }
@@ -20,12 +20,6 @@ public:
 	std::unique_ptr<VulkanFramebuffer> SceneFramebuffer;
 	std::unique_ptr<VulkanFramebuffer> PPImageFB[2];
 
-	struct
-	{
-		std::unique_ptr<VulkanFramebuffer> VTextureFB;
-		std::unique_ptr<VulkanFramebuffer> HTextureFB;
-	} BloomBlurLevels[NumBloomLevels];
-
 private:
 	UVulkanRenderDevice* renderer = nullptr;
 	std::vector<std::unique_ptr<VulkanFramebuffer>> SwapChainFramebuffers;
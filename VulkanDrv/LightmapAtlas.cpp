@@ -0,0 +1,165 @@
+
+#include "Precomp.h"
+#include "LightmapAtlas.h"
+#include "UVulkanRenderDevice.h"
+#include "CachedTexture.h"
+
+LightmapAtlas::LightmapAtlas(UVulkanRenderDevice* renderer) : renderer(renderer)
+{
+}
+
+LightmapAtlas::~LightmapAtlas()
+{
+}
+
+bool LightmapAtlas::GetLocation(FTextureInfo* info, uint64_t frameIndex, LightmapLocation& location)
+{
+	// Only the part inside the clamp region is ever sampled
+	int width = info->UClamp > 0 ? info->UClamp : info->USize;
+	int height = info->VClamp > 0 ? info->VClamp : info->VSize;
+
+	auto it = Entries.find(info->CacheID);
+	if (it == Entries.end())
+	{
+		if (width + Gutter * 2 > PageSize || height + Gutter * 2 > PageSize || !renderer->Uploads->SupportsAtlasUpload(*info))
+			return false;
+
+		int pageIndex = -1;
+		int x = 0, y = 0;
+		for (int i = 0; i < (int)Pages.size(); i++)
+		{
+			if (Allocate(Pages[i], width + Gutter * 2, height + Gutter * 2, x, y))
+			{
+				pageIndex = i;
+				break;
+			}
+		}
+
+		if (pageIndex == -1 && (int)Pages.size() < MaxPages)
+		{
+			CreatePage();
+			pageIndex = (int)Pages.size() - 1;
+			Allocate(Pages[pageIndex], width + Gutter * 2, height + Gutter * 2, x, y);
+		}
+
+		if (pageIndex == -1)
+		{
+			// Start over on the page that was used the longest time ago. Pages used by the current frame can't be reset, as the draws referencing them haven't been submitted yet.
+			int oldest = 0;
+			for (int i = 1; i < (int)Pages.size(); i++)
+			{
+				if (Pages[i].LastUsedFrame < Pages[oldest].LastUsedFrame)
+					oldest = i;
+			}
+			if (Pages[oldest].LastUsedFrame == frameIndex)
+				return false;
+
+			ResetPage(oldest);
+			pageIndex = oldest;
+			Allocate(Pages[pageIndex], width + Gutter * 2, height + Gutter * 2, x, y);
+		}
+
+		Entry entry;
+		entry.Page = pageIndex;
+		entry.X = x + Gutter;
+		entry.Y = y + Gutter;
+		it = Entries.insert({ info->CacheID, entry }).first;
+		Pages[pageIndex].Entries.push_back(info->CacheID);
+
+		renderer->Uploads->UploadAtlasRect(Pages[pageIndex].Texture.get(), *info, width, height, entry.X, entry.Y, Gutter);
+		info->bRealtimeChanged = 0;
+	}
+	else if (info->bRealtimeChanged)
+	{
+		info->bRealtimeChanged = 0;
+		renderer->Uploads->UploadAtlasRect(Pages[it->second.Page].Texture.get(), *info, width, height, it->second.X, it->second.Y, Gutter);
+	}
+
+	Page& page = Pages[it->second.Page];
+	page.LastUsedFrame = frameIndex;
+
+	location.Texture = page.Texture.get();
+	location.X = it->second.X;
+	location.Y = it->second.Y;
+	location.TextureWidth = PageSize;
+	location.TextureHeight = PageSize;
+	return true;
+}
+
+bool LightmapAtlas::Allocate(Page& page, int width, int height, int& x, int& y)
+{
+	// Use the lowest shelf the map fits on. Shelves much taller than the map are skipped to limit the wasted space.
+	Shelf* best = nullptr;
+	for (Shelf& shelf : page.Shelves)
+	{
+		if (shelf.Height >= height && shelf.Height <= height + height / 2 + 2 && shelf.X + width <= PageSize)
+		{
+			if (!best || shelf.Height < best->Height)
+				best = &shelf;
+		}
+	}
+
+	if (!best)
+	{
+		// Round the shelf height up so that maps of similar sizes can share it
+		int shelfHeight = std::min((height + 3) / 4 * 4, (int)PageSize);
+		if (page.NextShelfY + shelfHeight > PageSize)
+			return false;
+
+		Shelf shelf;
+		shelf.Y = page.NextShelfY;
+		shelf.Height = shelfHeight;
+		page.Shelves.push_back(shelf);
+		page.NextShelfY += shelfHeight;
+		best = &page.Shelves.back();
+	}
+
+	x = best->X;
+	y = best->Y;
+	best->X += width;
+	return true;
+}
+
+void LightmapAtlas::ResetPage(int index)
+{
+	Page& page = Pages[index];
+	for (QWORD cacheID : page.Entries)
+		Entries.erase(cacheID);
+	page.Entries.clear();
+	page.Shelves.clear();
+	page.NextShelfY = 0;
+}
+
+void LightmapAtlas::CreatePage()
+{
+	Page page;
+	page.Texture.reset(new CachedTexture());
+	page.Texture->ImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	page.Texture->ViewFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+	page.Texture->image = ImageBuilder()
+		.Format(VK_FORMAT_R8G8B8A8_UNORM)
+		.Size(PageSize, PageSize)
+		.Usage(VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
+		.DebugName("LightmapAtlas")
+		.Create(renderer->Device.get(), &page.Texture->AllocatedBytes);
+
+	page.Texture->imageView = ImageViewBuilder()
+		.Image(page.Texture->image.get(), VK_FORMAT_R8G8B8A8_UNORM)
+		.DebugName("LightmapAtlasView")
+		.Create(renderer->Device.get());
+
+	Pages.push_back(std::move(page));
+}
+
+void LightmapAtlas::Clear()
+{
+	for (int i = 0; i < (int)Pages.size(); i++)
+		ResetPage(i);
+}
+
+void LightmapAtlas::ClearAllBindlessIndexes()
+{
+	for (Page& page : Pages)
+		page.Texture->BindlessIndex = -1;
+}
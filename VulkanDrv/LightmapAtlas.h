@@ -0,0 +1,66 @@
+#pragma once
+
+struct FTextureInfo;
+class UVulkanRenderDevice;
+class CachedTexture;
+
+// Where a lightmap or fogmap ended up. The map occupies Width x Height texels of the texture, starting at X, Y.
+struct LightmapLocation
+{
+	CachedTexture* Texture = nullptr;
+	int X = 0;
+	int Y = 0;
+	int TextureWidth = 1;
+	int TextureHeight = 1;
+};
+
+// Packs lightmaps and fogmaps into a few large pages so that surfaces don't each need their own image and bindless slot
+class LightmapAtlas
+{
+public:
+	LightmapAtlas(UVulkanRenderDevice* renderer);
+	~LightmapAtlas();
+
+	// Returns false if the map has to use a texture of its own
+	bool GetLocation(FTextureInfo* info, uint64_t frameIndex, LightmapLocation& location);
+
+	void Clear();
+	void ClearAllBindlessIndexes();
+
+	int GetPageCount() const { return (int)Pages.size(); }
+	CachedTexture* GetPageTexture(int index) const { return Pages[index].Texture.get(); }
+
+	enum { PageSize = 2048, MaxPages = 4, Gutter = 1 };
+
+private:
+	struct Shelf
+	{
+		int Y = 0;
+		int Height = 0;
+		int X = 0;
+	};
+
+	struct Page
+	{
+		std::unique_ptr<CachedTexture> Texture;
+		std::vector<Shelf> Shelves;
+		int NextShelfY = 0;
+		uint64_t LastUsedFrame = 0;
+		std::vector<QWORD> Entries;
+	};
+
+	struct Entry
+	{
+		int Page = 0;
+		int X = 0;
+		int Y = 0;
+	};
+
+	bool Allocate(Page& page, int width, int height, int& x, int& y);
+	void ResetPage(int index);
+	void CreatePage();
+
+	UVulkanRenderDevice* renderer = nullptr;
+	std::vector<Page> Pages;
+	std::unordered_map<QWORD, Entry> Entries;
+};
@@ -0,0 +1,161 @@
+
+#include "Precomp.h"
+#include "MemoryStats.h"
+#include "UVulkanRenderDevice.h"
+
+MemoryStats::MemoryStats(UVulkanRenderDevice* renderer)
+{
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS] = {};
+	vmaGetHeapBudgets(renderer->Device->allocator, budgets);
+
+	const VkPhysicalDeviceMemoryProperties& memoryProperties = renderer->Device->PhysicalDevice.Properties.Memory;
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+	{
+		Heap heap;
+		heap.Size = memoryProperties.memoryHeaps[i].size;
+		heap.Usage = budgets[i].usage;
+		heap.Budget = budgets[i].budget;
+		heap.DeviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		Heaps.push_back(heap);
+	}
+
+	std::map<VkFormat, TextureManager::CacheStats> formats;
+	std::map<std::string, TextureManager::CacheStats> buckets;
+	renderer->Textures->GetCacheStats(formats, buckets);
+	for (auto& it : formats)
+	{
+		// Formats without a name of their own are all counted as Other
+		const char* name = GetFormatName(it.first);
+		auto group = std::find_if(Formats.begin(), Formats.end(), [&](const Group& g) { return g.Name == name; });
+		if (group == Formats.end())
+			group = Formats.insert(Formats.end(), Group{ name, 0, 0 });
+		group->Count += it.second.Count;
+		group->Bytes += it.second.Bytes;
+	}
+	for (auto& it : buckets)
+		Buckets.push_back(Group{ it.first, it.second.Count, it.second.Bytes });
+
+	// Largest first, as that is what one usually is looking for
+	std::stable_sort(Formats.begin(), Formats.end(), [](const Group& a, const Group& b) { return a.Bytes > b.Bytes; });
+
+	BindlessUsed = renderer->DescriptorSets->GetTextureArrayUsed();
+	BindlessMax = DescriptorSetManager::MaxBindlessTextures;
+	UploadHighWater = renderer->Uploads->GetUploadBufferHighWater();
+	UploadBufferSize = BufferManager::UploadBufferSize;
+	LastFrameUploadBytes = renderer->Uploads->GetLastFrameUploadBytes();
+	PipelineCount = renderer->RenderPasses->GetPipelineCount();
+}
+
+std::vector<std::string> MemoryStats::ToLines() const
+{
+	const double mb = 1.0 / (1024.0 * 1024.0);
+	std::vector<std::string> lines;
+	char line[256];
+
+	for (size_t i = 0; i < Heaps.size(); i++)
+	{
+		const Heap& heap = Heaps[i];
+		snprintf(line, sizeof(line), "Heap %d%s: %.1f of %.1f MB budget (%.1f MB heap)", (int)i, heap.DeviceLocal ? " (device local)" : "", heap.Usage * mb, heap.Budget * mb, heap.Size * mb);
+		lines.push_back(line);
+	}
+
+	for (const Group& group : Buckets)
+	{
+		snprintf(line, sizeof(line), "%s: %d textures, %.1f MB", group.Name.c_str(), group.Count, group.Bytes * mb);
+		lines.push_back(line);
+	}
+
+	for (const Group& group : Formats)
+	{
+		snprintf(line, sizeof(line), "%s: %d textures, %.1f MB", group.Name.c_str(), group.Count, group.Bytes * mb);
+		lines.push_back(line);
+	}
+
+	snprintf(line, sizeof(line), "Bindless slots: %d / %d", BindlessUsed, BindlessMax);
+	lines.push_back(line);
+	snprintf(line, sizeof(line), "Upload buffer high water: %.1f of %.1f MB", UploadHighWater * mb, UploadBufferSize * mb);
+	lines.push_back(line);
+	snprintf(line, sizeof(line), "Uploaded last frame: %.1f KB", LastFrameUploadBytes / 1024.0);
+	lines.push_back(line);
+	snprintf(line, sizeof(line), "Pipelines: %d", PipelineCount);
+	lines.push_back(line);
+	return lines;
+}
+
+bool MemoryStats::WriteJson(const std::string& filename) const
+{
+	FILE* file = fopen(filename.c_str(), "wb");
+	if (!file)
+		return false;
+
+	auto writeGroups = [&](const char* name, const std::vector<Group>& groups)
+	{
+		fprintf(file, "\t\"%s\": [\n", name);
+		for (size_t i = 0; i < groups.size(); i++)
+		{
+			const Group& group = groups[i];
+			fprintf(file, "\t\t{ \"name\": \"%s\", \"count\": %d, \"bytes\": %llu }%s\n", group.Name.c_str(), group.Count, (unsigned long long)group.Bytes, i + 1 < groups.size() ? "," : "");
+		}
+		fprintf(file, "\t],\n");
+	};
+
+	fprintf(file, "{\n");
+	fprintf(file, "\t\"heaps\": [\n");
+	for (size_t i = 0; i < Heaps.size(); i++)
+	{
+		const Heap& heap = Heaps[i];
+		fprintf(file, "\t\t{ \"index\": %d, \"deviceLocal\": %s, \"size\": %llu, \"usage\": %llu, \"budget\": %llu }%s\n",
+			(int)i, heap.DeviceLocal ? "true" : "false", (unsigned long long)heap.Size, (unsigned long long)heap.Usage, (unsigned long long)heap.Budget, i + 1 < Heaps.size() ? "," : "");
+	}
+	fprintf(file, "\t],\n");
+	writeGroups("textureBuckets", Buckets);
+	writeGroups("textureFormats", Formats);
+	fprintf(file, "\t\"bindlessSlotsUsed\": %d,\n", BindlessUsed);
+	fprintf(file, "\t\"bindlessSlotsMax\": %d,\n", BindlessMax);
+	fprintf(file, "\t\"uploadBufferHighWater\": %llu,\n", (unsigned long long)UploadHighWater);
+	fprintf(file, "\t\"uploadBufferSize\": %llu,\n", (unsigned long long)UploadBufferSize);
+	fprintf(file, "\t\"lastFrameUploadBytes\": %llu,\n", (unsigned long long)LastFrameUploadBytes);
+	fprintf(file, "\t\"pipelines\": %d\n", PipelineCount);
+	fprintf(file, "}\n");
+
+	bool result = ferror(file) == 0;
+	fclose(file);
+	return result;
+}
+
+const char* MemoryStats::GetFormatName(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_UNDEFINED: return "UNDEFINED";
+	case VK_FORMAT_R8_UNORM: return "R8_UNORM";
+	case VK_FORMAT_R8_UINT: return "R8_UINT";
+	case VK_FORMAT_R8G8_UNORM: return "R8G8_UNORM";
+	case VK_FORMAT_R8G8B8_UNORM: return "R8G8B8_UNORM";
+	case VK_FORMAT_R8G8B8A8_UNORM: return "R8G8B8A8_UNORM";
+	case VK_FORMAT_R8G8B8A8_SRGB: return "R8G8B8A8_SRGB";
+	case VK_FORMAT_B8G8R8A8_UNORM: return "B8G8R8A8_UNORM";
+	case VK_FORMAT_B8G8R8A8_SRGB: return "B8G8R8A8_SRGB";
+	case VK_FORMAT_R5G6B5_UNORM_PACK16: return "R5G6B5_UNORM";
+	case VK_FORMAT_R16G16B16A16_UNORM: return "R16G16B16A16_UNORM";
+	case VK_FORMAT_R16G16B16A16_SFLOAT: return "R16G16B16A16_SFLOAT";
+	case VK_FORMAT_R32G32B32A32_SFLOAT: return "R32G32B32A32_SFLOAT";
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK: return "BC1_RGB";
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: return "BC1_RGBA";
+	case VK_FORMAT_BC2_UNORM_BLOCK: return "BC2";
+	case VK_FORMAT_BC3_UNORM_BLOCK: return "BC3";
+	case VK_FORMAT_BC4_UNORM_BLOCK: return "BC4";
+	case VK_FORMAT_BC4_SNORM_BLOCK: return "BC4_SNORM";
+	case VK_FORMAT_BC5_UNORM_BLOCK: return "BC5";
+	case VK_FORMAT_BC5_SNORM_BLOCK: return "BC5_SNORM";
+	case VK_FORMAT_BC6H_UFLOAT_BLOCK: return "BC6H_UFLOAT";
+	case VK_FORMAT_BC6H_SFLOAT_BLOCK: return "BC6H_SFLOAT";
+	case VK_FORMAT_BC7_UNORM_BLOCK: return "BC7";
+	case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK: return "ETC2_RGB";
+	case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK: return "ETC2_RGBA1";
+	case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK: return "ETC2_RGBA";
+	case VK_FORMAT_EAC_R11_UNORM_BLOCK: return "EAC_R11";
+	case VK_FORMAT_EAC_R11G11_UNORM_BLOCK: return "EAC_R11G11";
+	default: return "Other";
+	}
+}
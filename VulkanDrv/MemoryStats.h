@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+class UVulkanRenderDevice;
+
+// Snapshot of GPU memory, texture cache and upload usage, as reported by the VKMEMSTATS command
+class MemoryStats
+{
+public:
+	MemoryStats(UVulkanRenderDevice* renderer);
+
+	// One line per entry, used both for the console report and the stat overlay
+	std::vector<std::string> ToLines() const;
+
+	bool WriteJson(const std::string& filename) const;
+
+	static const char* GetFormatName(VkFormat format);
+
+private:
+	struct Heap
+	{
+		VkDeviceSize Size = 0;
+		VkDeviceSize Usage = 0;
+		VkDeviceSize Budget = 0;
+		bool DeviceLocal = false;
+	};
+
+	struct Group
+	{
+		std::string Name;
+		int Count = 0;
+		VkDeviceSize Bytes = 0;
+	};
+
+	std::vector<Heap> Heaps;
+	std::vector<Group> Formats;
+	std::vector<Group> Buckets;
+	int BindlessUsed = 0;
+	int BindlessMax = 0;
+	size_t UploadHighWater = 0;
+	size_t UploadBufferSize = 0;
+	size_t LastFrameUploadBytes = 0;
+	int PipelineCount = 0;
+};
@@ -39,7 +39,7 @@ void RenderPassManager::CreateBloomPipelineLayout()
 {
 	Bloom.PipelineLayout = PipelineLayoutBuilder()
 		.AddSetLayout(renderer->DescriptorSets->GetBloomLayout())
-		.AddPushConstantRange(VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(BloomPushConstants))
+		.AddPushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BloomPushConstants))
 		.DebugName("BloomPipelineLayout")
 		.Create(renderer->Device.get());
 }
@@ -85,6 +85,26 @@ PipelineState* RenderPassManager::GetEndFlashPipeline()
 	return &Scene.Pipeline[2];
 }
 
+int RenderPassManager::GetPipelineCount() const
+{
+	int count = 0;
+	for (const PipelineState& state : Scene.Pipeline)
+		count += state.Pipeline ? 1 : 0;
+	for (const PipelineState& state : Scene.LinePipeline)
+		count += state.Pipeline ? 1 : 0;
+	for (const PipelineState& state : Scene.PointPipeline)
+		count += state.Pipeline ? 1 : 0;
+	for (const auto& pipeline : Present.Pipeline)
+		count += pipeline ? 1 : 0;
+	for (const auto& pipeline : Present.ScreenshotPipeline)
+		count += pipeline ? 1 : 0;
+	count += Bloom.Extract ? 1 : 0;
+	count += Bloom.Downsample ? 1 : 0;
+	count += Bloom.Upsample ? 1 : 0;
+	count += Bloom.Combine ? 1 : 0;
+	return count;
+}
+
 void RenderPassManager::CreatePipelines()
 {
 	VulkanShader* vertShader = renderer->Shaders->Scene.VertexShader.get();
@@ -111,8 +131,9 @@ void RenderPassManager::CreatePipelines()
 		builder.AddVertexAttribute(6, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(SceneVertex, Color));
 		builder.AddVertexAttribute(7, 0, VK_FORMAT_R32G32B32A32_SINT, offsetof(SceneVertex, TextureBinds));
 		builder.AddDynamicState(VK_DYNAMIC_STATE_VIEWPORT);
+		builder.AddDynamicState(VK_DYNAMIC_STATE_SCISSOR);
 		builder.Layout(layout);
-		builder.RenderPass(Scene.RenderPass.get());
+		SetSceneAttachments(builder);
 
 		// Avoid clipping the weapon. The UE1 engine clips the geometry anyway.
 		if (renderer->Device.get()->EnabledFeatures.Features.depthClamp)
@@ -185,8 +206,9 @@ void RenderPassManager::CreatePipelines()
 		builder.AddVertexAttribute(6, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(SceneVertex, Color));
 		builder.AddVertexAttribute(7, 0, VK_FORMAT_R32G32B32A32_SINT, offsetof(SceneVertex, TextureBinds));
 		builder.AddDynamicState(VK_DYNAMIC_STATE_VIEWPORT);
+		builder.AddDynamicState(VK_DYNAMIC_STATE_SCISSOR);
 		builder.Layout(layout);
-		builder.RenderPass(Scene.RenderPass.get());
+		SetSceneAttachments(builder);
 
 		builder.AddColorBlendAttachment(ColorBlendAttachmentBuilder().BlendMode(VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA).Create());
 		builder.AddColorBlendAttachment(ColorBlendAttachmentBuilder().Create());
@@ -226,8 +248,9 @@ void RenderPassManager::CreatePipelines()
 		builder.AddVertexAttribute(6, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(SceneVertex, Color));
 		builder.AddVertexAttribute(7, 0, VK_FORMAT_R32G32B32A32_SINT, offsetof(SceneVertex, TextureBinds));
 		builder.AddDynamicState(VK_DYNAMIC_STATE_VIEWPORT);
+		builder.AddDynamicState(VK_DYNAMIC_STATE_SCISSOR);
 		builder.Layout(layout);
-		builder.RenderPass(Scene.RenderPass.get());
+		SetSceneAttachments(builder);
 
 		builder.AddColorBlendAttachment(ColorBlendAttachmentBuilder().BlendMode(VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA).Create());
 		builder.AddColorBlendAttachment(ColorBlendAttachmentBuilder().Create());
@@ -246,69 +269,89 @@ void RenderPassManager::CreatePipelines()
 	}
 }
 
+void RenderPassManager::SetSceneAttachments(GraphicsPipelineBuilder& builder)
+{
+	if (renderer->UseDynamicRendering)
+	{
+		builder.AddColorAttachmentFormat(VK_FORMAT_R16G16B16A16_SFLOAT);
+		builder.AddColorAttachmentFormat(VK_FORMAT_R32_UINT);
+		builder.DepthStencilAttachmentFormat(VK_FORMAT_D32_SFLOAT);
+	}
+	else
+	{
+		builder.RenderPass(Scene.RenderPass.get());
+	}
+}
+
 void RenderPassManager::CreateRenderPass()
 {
-	Scene.RenderPass = RenderPassBuilder()
-		.AddAttachment(
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			renderer->Textures->Scene->SceneSamples,
-			VK_ATTACHMENT_LOAD_OP_CLEAR,
-			VK_ATTACHMENT_STORE_OP_STORE,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-		.AddAttachment(
-			VK_FORMAT_R32_UINT,
-			renderer->Textures->Scene->SceneSamples,
-			VK_ATTACHMENT_LOAD_OP_CLEAR,
-			VK_ATTACHMENT_STORE_OP_STORE,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-		.AddDepthStencilAttachment(
-			VK_FORMAT_D32_SFLOAT,
-			renderer->Textures->Scene->SceneSamples,
-			VK_ATTACHMENT_LOAD_OP_CLEAR,
-			VK_ATTACHMENT_STORE_OP_STORE,
-			VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-			VK_ATTACHMENT_STORE_OP_DONT_CARE,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-		.AddSubpass()
-		.AddSubpassColorAttachmentRef(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-		.AddSubpassColorAttachmentRef(1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-		.AddSubpassDepthStencilAttachmentRef(2, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-		.DebugName("SceneRenderPass")
-		.Create(renderer->Device.get());
+	// With dynamic rendering the pipelines are built against the attachment formats instead
+	if (renderer->UseDynamicRendering)
+		return;
 
-	Scene.RenderPassContinue = RenderPassBuilder()
-		.AddAttachment(
+	VkSampleCountFlagBits samples = renderer->Textures->Scene->SceneSamples;
+
+	// Every attachment is stored, even the ones nobody reads after the frame ends. Flush and FlushDrawBatchAndWait can split
+	// the pass across submits at any time, and RenderPassContinue then loads what the first part of the frame drew.
+	// For the same reason the multisampled color and depth buffers can't be transient, lazily allocated images.
+	for (int i = 0; i < 2; i++)
+	{
+		bool continuePass = (i == 1);
+
+		RenderPassBuilder builder;
+		builder.AddAttachment(
 			VK_FORMAT_R16G16B16A16_SFLOAT,
-			renderer->Textures->Scene->SceneSamples,
-			VK_ATTACHMENT_LOAD_OP_LOAD,
+			samples,
+			continuePass ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,
 			VK_ATTACHMENT_STORE_OP_STORE,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-		.AddAttachment(
+			continuePass ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		builder.AddAttachment(
 			VK_FORMAT_R32_UINT,
-			renderer->Textures->Scene->SceneSamples,
-			VK_ATTACHMENT_LOAD_OP_LOAD,
+			samples,
+			continuePass ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,
 			VK_ATTACHMENT_STORE_OP_STORE,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-		.AddDepthStencilAttachment(
+			continuePass ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		builder.AddDepthStencilAttachment(
 			VK_FORMAT_D32_SFLOAT,
-			renderer->Textures->Scene->SceneSamples,
-			VK_ATTACHMENT_LOAD_OP_LOAD,
+			samples,
+			continuePass ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,
 			VK_ATTACHMENT_STORE_OP_STORE,
 			VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 			VK_ATTACHMENT_STORE_OP_DONT_CARE,
-			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-		.AddSubpass()
-		.AddSubpassColorAttachmentRef(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-		.AddSubpassColorAttachmentRef(1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-		.AddSubpassDepthStencilAttachmentRef(2, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-		.DebugName("SceneRenderPassContinue")
-		.Create(renderer->Device.get());
+			continuePass ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+		// Multisampled scene color is resolved into PPImage[0] at the end of the pass
+		if (samples != VK_SAMPLE_COUNT_1_BIT)
+		{
+			builder.AddAttachment(
+				VK_FORMAT_R16G16B16A16_SFLOAT,
+				VK_SAMPLE_COUNT_1_BIT,
+				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				VK_ATTACHMENT_STORE_OP_STORE,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		}
+
+		builder.AddSubpass();
+		builder.AddSubpassColorAttachmentRef(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		builder.AddSubpassColorAttachmentRef(1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		builder.AddSubpassDepthStencilAttachmentRef(2, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+		if (samples != VK_SAMPLE_COUNT_1_BIT)
+		{
+			builder.AddSubpassResolveAttachmentRef(3, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+			builder.AddSubpassResolveAttachmentRef(VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED);
+		}
+
+		builder.DebugName(continuePass ? "SceneRenderPassContinue" : "SceneRenderPass");
+
+		if (continuePass)
+			Scene.RenderPassContinue = builder.Create(renderer->Device.get());
+		else
+			Scene.RenderPass = builder.Create(renderer->Device.get());
+	}
 }
 
 void RenderPassManager::CreatePresentRenderPass()
@@ -373,71 +416,31 @@ void RenderPassManager::CreatePostprocessRenderPass()
 		.AddSubpassColorAttachmentRef(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
 		.DebugName("PPRenderPass")
 		.Create(renderer->Device.get());
-
-	Postprocess.RenderPassCombine = RenderPassBuilder()
-		.AddAttachment(
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_SAMPLE_COUNT_1_BIT,
-			VK_ATTACHMENT_LOAD_OP_LOAD,
-			VK_ATTACHMENT_STORE_OP_STORE,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-		.AddSubpass()
-		.AddSubpassColorAttachmentRef(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-		.DebugName("PPRenderPassCombine")
-		.Create(renderer->Device.get());
 }
 
 void RenderPassManager::CreateBloomPipeline()
 {
-	Bloom.Extract = GraphicsPipelineBuilder()
-		.AddVertexShader(renderer->Shaders->Postprocess.VertexShader.get())
-		.AddFragmentShader(renderer->Shaders->Bloom.Extract.get())
-		.AddDynamicState(VK_DYNAMIC_STATE_VIEWPORT)
-		.AddDynamicState(VK_DYNAMIC_STATE_SCISSOR)
+	Bloom.Extract = ComputePipelineBuilder()
+		.ComputeShader(renderer->Shaders->Bloom.Extract.get())
 		.Layout(Bloom.PipelineLayout.get())
-		.RenderPass(Postprocess.RenderPass.get())
 		.DebugName("Bloom.Extract")
 		.Create(renderer->Device.get());
 
-	Bloom.Combine = GraphicsPipelineBuilder()
-		.AddVertexShader(renderer->Shaders->Postprocess.VertexShader.get())
-		.AddFragmentShader(renderer->Shaders->Bloom.Combine.get())
-		.AddDynamicState(VK_DYNAMIC_STATE_VIEWPORT)
-		.AddDynamicState(VK_DYNAMIC_STATE_SCISSOR)
-		.AddColorBlendAttachment(ColorBlendAttachmentBuilder().BlendMode(VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE).Create())
-		.Layout(Bloom.PipelineLayout.get())
-		.RenderPass(Postprocess.RenderPass.get())
-		.DebugName("Bloom.Combine")
-		.Create(renderer->Device.get());
-
-	Bloom.Scale = GraphicsPipelineBuilder()
-		.AddVertexShader(renderer->Shaders->Postprocess.VertexShader.get())
-		.AddFragmentShader(renderer->Shaders->Bloom.Combine.get())
-		.AddDynamicState(VK_DYNAMIC_STATE_VIEWPORT)
-		.AddDynamicState(VK_DYNAMIC_STATE_SCISSOR)
+	Bloom.Downsample = ComputePipelineBuilder()
+		.ComputeShader(renderer->Shaders->Bloom.Downsample.get())
 		.Layout(Bloom.PipelineLayout.get())
-		.RenderPass(Postprocess.RenderPass.get())
-		.DebugName("Bloom.Copy")
+		.DebugName("Bloom.Downsample")
 		.Create(renderer->Device.get());
 
-	Bloom.BlurVertical = GraphicsPipelineBuilder()
-		.AddVertexShader(renderer->Shaders->Postprocess.VertexShader.get())
-		.AddFragmentShader(renderer->Shaders->Bloom.BlurVertical.get())
-		.AddDynamicState(VK_DYNAMIC_STATE_VIEWPORT)
-		.AddDynamicState(VK_DYNAMIC_STATE_SCISSOR)
+	Bloom.Upsample = ComputePipelineBuilder()
+		.ComputeShader(renderer->Shaders->Bloom.Upsample.get())
 		.Layout(Bloom.PipelineLayout.get())
-		.RenderPass(Postprocess.RenderPass.get())
-		.DebugName("Bloom.BlurVertical")
+		.DebugName("Bloom.Upsample")
 		.Create(renderer->Device.get());
 
-	Bloom.BlurHorizontal = GraphicsPipelineBuilder()
-		.AddVertexShader(renderer->Shaders->Postprocess.VertexShader.get())
-		.AddFragmentShader(renderer->Shaders->Bloom.BlurHorizontal.get())
-		.AddDynamicState(VK_DYNAMIC_STATE_VIEWPORT)
-		.AddDynamicState(VK_DYNAMIC_STATE_SCISSOR)
+	Bloom.Combine = ComputePipelineBuilder()
+		.ComputeShader(renderer->Shaders->Bloom.Combine.get())
 		.Layout(Bloom.PipelineLayout.get())
-		.RenderPass(Postprocess.RenderPass.get())
-		.DebugName("Bloom.BlurHorizontal")
+		.DebugName("Bloom.Combine")
 		.Create(renderer->Device.get());
 }
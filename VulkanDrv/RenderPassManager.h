@@ -26,6 +26,7 @@ public:
 	void CreateBloomPipeline();
 
 	PipelineState* GetPipeline(DWORD polyflags);
+	int GetPipelineCount() const;
 	PipelineState* GetEndFlashPipeline();
 	PipelineState* GetLinePipeline(bool occludeLines) { return &Scene.LinePipeline[occludeLines]; }
 	PipelineState* GetPointPipeline(bool occludeLines) { return &Scene.PointPipeline[occludeLines]; }
@@ -52,19 +53,18 @@ public:
 	{
 		std::unique_ptr<VulkanPipelineLayout> PipelineLayout;
 		std::unique_ptr<VulkanPipeline> Extract;
+		std::unique_ptr<VulkanPipeline> Downsample;
+		std::unique_ptr<VulkanPipeline> Upsample;
 		std::unique_ptr<VulkanPipeline> Combine;
-		std::unique_ptr<VulkanPipeline> Scale;
-		std::unique_ptr<VulkanPipeline> BlurVertical;
-		std::unique_ptr<VulkanPipeline> BlurHorizontal;
 	} Bloom;
 
 	struct
 	{
 		std::unique_ptr<VulkanRenderPass> RenderPass;
-		std::unique_ptr<VulkanRenderPass> RenderPassCombine;
 	} Postprocess;
 
 private:
+	void SetSceneAttachments(GraphicsPipelineBuilder& builder);
 	void CreateSceneBindlessPipelineLayout();
 	void CreatePresentPipelineLayout();
 	void CreateBloomPipelineLayout();
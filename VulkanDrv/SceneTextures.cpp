@@ -7,11 +7,16 @@ SceneTextures::SceneTextures(UVulkanRenderDevice* renderer, int width, int heigh
 {
 	SceneSamples = GetBestSampleCount(renderer->Device.get(), multisample);
 
+	// Without multisampling the postprocess passes read (and bloom writes) the color buffer directly. Dynamic resolution upscales it in place.
+	VkImageUsageFlags colorUsage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	if (SceneSamples == VK_SAMPLE_COUNT_1_BIT)
+		colorUsage |= VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
 	ColorBuffer = ImageBuilder()
 		.Size(width, height)
 		.Samples(SceneSamples)
 		.Format(VK_FORMAT_R16G16B16A16_SFLOAT)
-		.Usage(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT)
+		.Usage(colorUsage)
 		.DebugName("colorBuffer")
 		.Create(renderer->Device.get());
 
@@ -52,7 +57,7 @@ SceneTextures::SceneTextures(UVulkanRenderDevice* renderer, int width, int heigh
 			.Size(width, height)
 			.Samples(VK_SAMPLE_COUNT_1_BIT)
 			.Format(VK_FORMAT_R16G16B16A16_SFLOAT)
-			.Usage(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+			.Usage(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT)
 			.DebugName("ppImage")
 			.Create(renderer->Device.get());
 
@@ -62,6 +67,17 @@ SceneTextures::SceneTextures(UVulkanRenderDevice* renderer, int width, int heigh
 			.Create(renderer->Device.get());
 	}
 
+	if (SceneSamples == VK_SAMPLE_COUNT_1_BIT)
+	{
+		ResolvedColorBuffer = ColorBuffer.get();
+		ResolvedColorBufferView = ColorBufferView.get();
+	}
+	else
+	{
+		ResolvedColorBuffer = PPImage[0].get();
+		ResolvedColorBufferView = PPImageView[0].get();
+	}
+
 	PPHitBuffer = ImageBuilder()
 		.Size(width, height)
 		.Samples(VK_SAMPLE_COUNT_1_BIT)
@@ -90,7 +106,7 @@ SceneTextures::SceneTextures(UVulkanRenderDevice* renderer, int width, int heigh
 			.Size(bloomWidth, bloomHeight)
 			.Samples(VK_SAMPLE_COUNT_1_BIT)
 			.Format(VK_FORMAT_R16G16B16A16_SFLOAT)
-			.Usage(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
+			.Usage(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT)
 			.DebugName("BloomVTexture")
 			.Create(renderer->Device.get());
 
@@ -98,7 +114,7 @@ SceneTextures::SceneTextures(UVulkanRenderDevice* renderer, int width, int heigh
 			.Size(bloomWidth, bloomHeight)
 			.Samples(VK_SAMPLE_COUNT_1_BIT)
 			.Format(VK_FORMAT_R16G16B16A16_SFLOAT)
-			.Usage(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
+			.Usage(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT)
 			.DebugName("BloomHTexture")
 			.Create(renderer->Device.get());
 
@@ -139,24 +155,6 @@ SceneTextures::SceneTextures(UVulkanRenderDevice* renderer, int width, int heigh
 		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
 		VK_IMAGE_ASPECT_DEPTH_BIT);
 
-	for (int level = 0; level < NumBloomLevels; level++)
-	{
-		barrier.AddImage(
-			BloomBlurLevels[level].VTexture.get(),
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			0,
-			VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-			VK_IMAGE_ASPECT_COLOR_BIT);
-		barrier.AddImage(
-			BloomBlurLevels[level].HTexture.get(),
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			0,
-			VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-			VK_IMAGE_ASPECT_COLOR_BIT);
-	}
-
 	barrier.Execute(
 		renderer->Commands->GetDrawCommands(),
 		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
@@ -33,6 +33,10 @@ public:
 	std::unique_ptr<VulkanImage> PPImage[2];
 	std::unique_ptr<VulkanImageView> PPImageView[2];
 
+	// Single sampled scene color. This is the color buffer itself without multisampling, otherwise PPImage[0] acting as the render pass resolve target
+	VulkanImage* ResolvedColorBuffer = nullptr;
+	VulkanImageView* ResolvedColorBufferView = nullptr;
+
 	// Texture and buffer used to download the hitbuffer
 	std::unique_ptr<VulkanImage> PPHitBuffer;
 	std::unique_ptr<VulkanBuffer> StagingHitBuffer;
@@ -50,28 +50,28 @@ ShaderManager::ShaderManager(UVulkanRenderDevice* renderer) : renderer(renderer)
 	}
 
 	Bloom.Extract = ShaderBuilder()
-		.Type(ShaderType::Fragment)
-		.AddSource("shaders/BloomExtract.frag", LoadShaderCode("shaders/BloomExtract.frag"))
+		.Type(ShaderType::Compute)
+		.AddSource("shaders/BloomExtract.comp", LoadShaderCode("shaders/BloomDownsample.comp", "#define BLOOM_EXTRACT"))
 		.DebugName("BloomPass.Extract")
 		.Create("BloomPass.Extract", renderer->Device.get());
 
+	Bloom.Downsample = ShaderBuilder()
+		.Type(ShaderType::Compute)
+		.AddSource("shaders/BloomDownsample.comp", LoadShaderCode("shaders/BloomDownsample.comp"))
+		.DebugName("BloomPass.Downsample")
+		.Create("BloomPass.Downsample", renderer->Device.get());
+
+	Bloom.Upsample = ShaderBuilder()
+		.Type(ShaderType::Compute)
+		.AddSource("shaders/BloomUpsample.comp", LoadShaderCode("shaders/BloomUpsample.comp"))
+		.DebugName("BloomPass.Upsample")
+		.Create("BloomPass.Upsample", renderer->Device.get());
+
 	Bloom.Combine = ShaderBuilder()
-		.Type(ShaderType::Fragment)
-		.AddSource("shaders/BloomCombine.frag", LoadShaderCode("shaders/BloomCombine.frag"))
+		.Type(ShaderType::Compute)
+		.AddSource("shaders/BloomCombine.comp", LoadShaderCode("shaders/BloomUpsample.comp", "#define BLOOM_COMBINE"))
 		.DebugName("BloomPass.Combine")
 		.Create("BloomPass.Combine", renderer->Device.get());
-
-	Bloom.BlurVertical = ShaderBuilder()
-		.Type(ShaderType::Fragment)
-		.AddSource("shaders/BlurVertical.frag", LoadShaderCode("shaders/Blur.frag", "#define BLUR_VERTICAL"))
-		.DebugName("BloomPass.BlurVertical")
-		.Create("BloomPass.BlurVertical", renderer->Device.get());
-
-	Bloom.BlurHorizontal = ShaderBuilder()
-		.Type(ShaderType::Fragment)
-		.AddSource("shaders/BlurHorizontal.frag", LoadShaderCode("shaders/Blur.frag", "#define BLUR_HORIZONTAL"))
-		.DebugName("BloomPass.BlurHorizontal")
-		.Create("BloomPass.BlurHorizontal", renderer->Device.get());
 }
 
 ShaderManager::~ShaderManager()
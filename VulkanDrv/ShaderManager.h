@@ -35,7 +35,10 @@ struct PresentPushConstants
 
 struct BloomPushConstants
 {
-	float SampleWeights[8];
+	float Offset;
+	float Intensity;
+	float Padding0;
+	float Padding1;
 };
 
 class ShaderManager
@@ -60,9 +63,9 @@ public:
 	struct
 	{
 		std::unique_ptr<VulkanShader> Extract;
+		std::unique_ptr<VulkanShader> Downsample;
+		std::unique_ptr<VulkanShader> Upsample;
 		std::unique_ptr<VulkanShader> Combine;
-		std::unique_ptr<VulkanShader> BlurVertical;
-		std::unique_ptr<VulkanShader> BlurHorizontal;
 	} Bloom;
 
 	static std::string LoadShaderCode(const std::string& filename, const std::string& defines = {});
@@ -0,0 +1,117 @@
+
+#include "Precomp.h"
+#include "TextureCacheMap.h"
+#include "CachedTexture.h"
+
+TextureCacheMap::TextureCacheMap()
+{
+	Entries.resize(256);
+	Mask = Entries.size() - 1;
+}
+
+TextureCacheMap::~TextureCacheMap()
+{
+}
+
+size_t TextureCacheMap::FindSlot(QWORD key) const
+{
+	// Linear probing. Ends at the entry with the key or at the first unused slot.
+	size_t slot = MixHash(key) & Mask;
+	while (Entries[slot].Used && Entries[slot].Key != key)
+		slot = (slot + 1) & Mask;
+	return slot;
+}
+
+CachedTexture* TextureCacheMap::Find(QWORD key)
+{
+	const Entry& last = Entries[LastHit];
+	if (last.Used && last.Key == key)
+		return last.Value.get();
+
+	size_t slot = FindSlot(key);
+	if (!Entries[slot].Used)
+		return nullptr;
+
+	LastHit = slot;
+	return Entries[slot].Value.get();
+}
+
+CachedTexture* TextureCacheMap::Insert(QWORD key, std::unique_ptr<CachedTexture> value)
+{
+	// Keep the load below one half so that the probe sequences stay short
+	if ((Count + 1) * 2 > Entries.size())
+		Grow();
+
+	size_t slot = FindSlot(key);
+	Entry& entry = Entries[slot];
+	if (!entry.Used)
+	{
+		entry.Key = key;
+		entry.Used = true;
+		Count++;
+	}
+	entry.Value = std::move(value);
+	LastHit = slot;
+	return entry.Value.get();
+}
+
+std::unique_ptr<CachedTexture> TextureCacheMap::Remove(QWORD key)
+{
+	size_t slot = FindSlot(key);
+	if (!Entries[slot].Used)
+		return nullptr;
+
+	std::unique_ptr<CachedTexture> value = std::move(Entries[slot].Value);
+	Entries[slot].Used = false;
+	Count--;
+
+	// Move later entries of the probe sequence back into the hole, so that lookups don't need tombstones
+	size_t hole = slot;
+	size_t next = (slot + 1) & Mask;
+	while (Entries[next].Used)
+	{
+		size_t home = MixHash(Entries[next].Key) & Mask;
+		if (((next - home) & Mask) >= ((next - hole) & Mask))
+		{
+			Entries[hole].Key = Entries[next].Key;
+			Entries[hole].Value = std::move(Entries[next].Value);
+			Entries[hole].Used = true;
+			Entries[next].Used = false;
+			hole = next;
+		}
+		next = (next + 1) & Mask;
+	}
+
+	return value;
+}
+
+void TextureCacheMap::Clear()
+{
+	for (Entry& entry : Entries)
+	{
+		entry.Value.reset();
+		entry.Used = false;
+	}
+	Count = 0;
+}
+
+void TextureCacheMap::Grow()
+{
+	std::vector<Entry> oldEntries;
+	oldEntries.swap(Entries);
+
+	Entries.resize(oldEntries.size() * 2);
+	Mask = Entries.size() - 1;
+	LastHit = 0;
+
+	for (Entry& entry : oldEntries)
+	{
+		if (entry.Used)
+		{
+			size_t slot = FindSlot(entry.Key);
+			Entries[slot].Key = entry.Key;
+			Entries[slot].Value = std::move(entry.Value);
+			Entries[slot].Used = true;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+class CachedTexture;
+
+// Mixes all bits of a 64-bit value. Cache IDs and pointers have most of their entropy in a few bits.
+inline uint64_t MixHash(uint64_t h)
+{
+	h ^= h >> 30;
+	h *= 0xBF58476D1CE4E5B9ULL;
+	h ^= h >> 27;
+	h *= 0x94D049BB133111EBULL;
+	h ^= h >> 31;
+	return h;
+}
+
+// Open addressing hash table from cache IDs to textures.
+// Lookups remember the slot of the last hit, as consecutive surfaces tend to use the same textures.
+class TextureCacheMap
+{
+public:
+	struct Entry
+	{
+		QWORD Key = 0;
+		std::unique_ptr<CachedTexture> Value;
+		bool Used = false;
+	};
+
+	TextureCacheMap();
+	~TextureCacheMap();
+
+	CachedTexture* Find(QWORD key);
+	CachedTexture* Insert(QWORD key, std::unique_ptr<CachedTexture> value);
+	std::unique_ptr<CachedTexture> Remove(QWORD key);
+	void Clear();
+
+	size_t Size() const { return Count; }
+
+	class Iterator
+	{
+	public:
+		Iterator(Entry* entry, Entry* end) : entry(entry), end(end) { SkipUnused(); }
+		Entry& operator*() const { return *entry; }
+		Iterator& operator++() { entry++; SkipUnused(); return *this; }
+		bool operator!=(const Iterator& other) const { return entry != other.entry; }
+
+	private:
+		void SkipUnused() { while (entry != end && !entry->Used) entry++; }
+
+		Entry* entry;
+		Entry* end;
+	};
+
+	Iterator begin() { return Iterator(Entries.data(), Entries.data() + Entries.size()); }
+	Iterator end() { return Iterator(Entries.data() + Entries.size(), Entries.data() + Entries.size()); }
+
+private:
+	size_t FindSlot(QWORD key) const;
+	void Grow();
+
+	std::vector<Entry> Entries;
+	size_t Count = 0;
+	size_t Mask = 0;
+	size_t LastHit = 0;
+};
@@ -0,0 +1,244 @@
+
+#include "Precomp.h"
+#include "TextureCompressor.h"
+#include <cmath>
+
+namespace
+{
+	struct BlockColors
+	{
+		int r[16], g[16], b[16];
+		bool used[16];
+		int count = 0;
+	};
+
+	uint16_t PackRGB565(int r, int g, int b)
+	{
+		r = (r * 31 + 127) / 255;
+		g = (g * 63 + 127) / 255;
+		b = (b * 31 + 127) / 255;
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	void UnpackRGB565(uint16_t c, int* rgb)
+	{
+		int r = (c >> 11) & 31;
+		int g = (c >> 5) & 63;
+		int b = c & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	// Picks two endpoints along the principal axis of the used colors
+	void FindEndpoints(const BlockColors& colors, uint16_t& c0, uint16_t& c1)
+	{
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			if (colors.used[i])
+			{
+				mean[0] += colors.r[i];
+				mean[1] += colors.g[i];
+				mean[2] += colors.b[i];
+			}
+		}
+		for (int j = 0; j < 3; j++)
+			mean[j] /= colors.count;
+
+		float cov[6] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			if (colors.used[i])
+			{
+				float r = colors.r[i] - mean[0];
+				float g = colors.g[i] - mean[1];
+				float b = colors.b[i] - mean[2];
+				cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+				cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+			}
+		}
+
+		// Power iteration for the dominant eigenvector
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iter = 0; iter < 4; iter++)
+		{
+			float x = axis[0] * cov[0] + axis[1] * cov[1] + axis[2] * cov[2];
+			float y = axis[0] * cov[1] + axis[1] * cov[3] + axis[2] * cov[4];
+			float z = axis[0] * cov[2] + axis[1] * cov[4] + axis[2] * cov[5];
+			float len = std::max(std::max(std::abs(x), std::abs(y)), std::abs(z));
+			if (len < 1e-6f)
+				break;
+			axis[0] = x / len;
+			axis[1] = y / len;
+			axis[2] = z / len;
+		}
+
+		float minT = 1e30f, maxT = -1e30f;
+		int minIndex = 0, maxIndex = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			if (colors.used[i])
+			{
+				float t = colors.r[i] * axis[0] + colors.g[i] * axis[1] + colors.b[i] * axis[2];
+				if (t < minT) { minT = t; minIndex = i; }
+				if (t > maxT) { maxT = t; maxIndex = i; }
+			}
+		}
+
+		// Inset the endpoints slightly, as the extremes are rarely hit exactly after quantization
+		int minColor[3] = { colors.r[minIndex], colors.g[minIndex], colors.b[minIndex] };
+		int maxColor[3] = { colors.r[maxIndex], colors.g[maxIndex], colors.b[maxIndex] };
+		for (int j = 0; j < 3; j++)
+		{
+			int inset = (maxColor[j] - minColor[j]) / 16;
+			minColor[j] = std::min(std::max(minColor[j] + inset, 0), 255);
+			maxColor[j] = std::min(std::max(maxColor[j] - inset, 0), 255);
+		}
+
+		c0 = PackRGB565(maxColor[0], maxColor[1], maxColor[2]);
+		c1 = PackRGB565(minColor[0], minColor[1], minColor[2]);
+	}
+
+	void WriteColorBlock(const uint8_t* pixels, int redIndex, bool allowTransparent, uint8_t* dest)
+	{
+		BlockColors colors;
+		bool transparent = false;
+		for (int i = 0; i < 16; i++)
+		{
+			const uint8_t* p = pixels + i * 4;
+			colors.r[i] = p[redIndex];
+			colors.g[i] = p[1];
+			colors.b[i] = p[2 - redIndex];
+			colors.used[i] = !allowTransparent || p[3] >= 128;
+			if (colors.used[i])
+				colors.count++;
+			else
+				transparent = true;
+		}
+
+		uint16_t c0 = 0, c1 = 0;
+		if (colors.count > 0)
+			FindEndpoints(colors, c0, c1);
+
+		// c0 > c1 selects the four color mode, c0 <= c1 the three color mode with transparent black
+		if (transparent ? c0 > c1 : c0 < c1)
+			std::swap(c0, c1);
+
+		// Equal endpoints would select the three color mode, where index 3 is transparent black. Nudge one apart to stay opaque.
+		if (!transparent && c0 == c1)
+		{
+			if (c1 > 0)
+				c1--;
+			else
+				c0++;
+		}
+
+		int palette[4][3];
+		UnpackRGB565(c0, palette[0]);
+		UnpackRGB565(c1, palette[1]);
+		int numColors;
+		if (!transparent)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				palette[2][j] = (2 * palette[0][j] + palette[1][j]) / 3;
+				palette[3][j] = (palette[0][j] + 2 * palette[1][j]) / 3;
+			}
+			numColors = 4;
+		}
+		else
+		{
+			for (int j = 0; j < 3; j++)
+				palette[2][j] = (palette[0][j] + palette[1][j]) / 2;
+			numColors = 3;
+		}
+
+		uint32_t indexes = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 3;
+			if (colors.used[i])
+			{
+				int bestDist = 0x7fffffff;
+				for (int k = 0; k < numColors; k++)
+				{
+					int dr = colors.r[i] - palette[k][0];
+					int dg = colors.g[i] - palette[k][1];
+					int db = colors.b[i] - palette[k][2];
+					int dist = dr * dr + dg * dg + db * db;
+					if (dist < bestDist)
+					{
+						bestDist = dist;
+						best = k;
+					}
+				}
+			}
+			indexes |= (uint32_t)best << (i * 2);
+		}
+
+		dest[0] = c0 & 0xff;
+		dest[1] = c0 >> 8;
+		dest[2] = c1 & 0xff;
+		dest[3] = c1 >> 8;
+		dest[4] = indexes & 0xff;
+		dest[5] = (indexes >> 8) & 0xff;
+		dest[6] = (indexes >> 16) & 0xff;
+		dest[7] = indexes >> 24;
+	}
+
+	void WriteAlphaBlock(const uint8_t* pixels, uint8_t* dest)
+	{
+		int a0 = 0, a1 = 255;
+		for (int i = 0; i < 16; i++)
+		{
+			int a = pixels[i * 4 + 3];
+			a0 = std::max(a0, a);
+			a1 = std::min(a1, a);
+		}
+
+		// a0 > a1 selects eight interpolated values. Index 0 is a0, index 1 is a1 and 2-7 are the steps between them.
+		int palette[8];
+		palette[0] = a0;
+		palette[1] = a1;
+		for (int k = 1; k < 7; k++)
+			palette[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+
+		uint64_t indexes = 0;
+		if (a0 != a1)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				int a = pixels[i * 4 + 3];
+				int best = 0;
+				int bestDist = 256;
+				for (int k = 0; k < 8; k++)
+				{
+					int dist = std::abs(a - palette[k]);
+					if (dist < bestDist)
+					{
+						bestDist = dist;
+						best = k;
+					}
+				}
+				indexes |= (uint64_t)best << (i * 3);
+			}
+		}
+
+		dest[0] = (uint8_t)a0;
+		dest[1] = (uint8_t)a1;
+		for (int i = 0; i < 6; i++)
+			dest[2 + i] = (uint8_t)(indexes >> (i * 8));
+	}
+}
+
+void CompressBlockBC1(const uint8_t* pixels, int redIndex, bool transparent, uint8_t* dest)
+{
+	WriteColorBlock(pixels, redIndex, transparent, dest);
+}
+
+void CompressBlockBC3(const uint8_t* pixels, int redIndex, uint8_t* dest)
+{
+	WriteAlphaBlock(pixels, dest);
+	WriteColorBlock(pixels, redIndex, false, dest + 8);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// Block encoders for compressing converted textures at load time.
+// Each function takes a 4x4 block of 8-bit pixels (16 pixels, 4 bytes each) and writes one compressed block.
+// RedIndex selects whether the pixels are in RGBA (0) or BGRA (2) byte order.
+
+// BC1 with 4 colors. If transparent is set, pixels with alpha below 128 switch the block to 3 colors plus transparent black. Writes 8 bytes.
+void CompressBlockBC1(const uint8_t* pixels, int redIndex, bool transparent, uint8_t* dest);
+
+// BC3 with interpolated alpha. Writes 16 bytes.
+void CompressBlockBC3(const uint8_t* pixels, int redIndex, uint8_t* dest);
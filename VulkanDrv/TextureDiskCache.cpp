@@ -0,0 +1,198 @@
+
+#include "Precomp.h"
+#include "TextureDiskCache.h"
+#include <ctime>
+
+TextureDiskCache::TextureDiskCache(const std::string& directory, int64_t maxSize) : Directory(directory), MaxSize(maxSize)
+{
+	GFileManager->MakeDirectory(appFromAnsi(Directory.c_str()), 1);
+
+	// Temporary files are left behind by writes that got interrupted
+	TArray<FString> tmpfiles = GFileManager->FindFiles(appFromAnsi((Directory + "/*.tmp").c_str()), 1, 0);
+	for (int i = 0; i < tmpfiles.Num(); i++)
+		RemoveInvalidFile(Directory + "/" + appToAnsi(*tmpfiles(i)));
+
+	TArray<FString> files = GFileManager->FindFiles(appFromAnsi((Directory + "/*.bin").c_str()), 1, 0);
+	for (int i = 0; i < files.Num(); i++)
+	{
+		std::string filename = Directory + "/" + appToAnsi(*files(i));
+		uint64_t key = strtoull(appToAnsi(*files(i)), nullptr, 16);
+
+		bool valid = false;
+		FILE* file = fopen(filename.c_str(), "rb");
+		if (file)
+		{
+			FileHeader header;
+			if (ReadHeader(file, key, header) && filename == GetFilename(key))
+			{
+				Entry& entry = Entries[key];
+				entry.PayloadSize = header.PayloadSize;
+				entry.LastUsed = header.LastUsed;
+				TotalSize += header.PayloadSize + sizeof(FileHeader);
+				valid = true;
+			}
+			fclose(file);
+		}
+
+		// Entries of an older version or with a damaged header would otherwise never be used nor pruned
+		if (!valid)
+			RemoveInvalidFile(filename);
+	}
+
+	Prune();
+}
+
+bool TextureDiskCache::Load(uint64_t key, const EntryDesc& desc, void* dest, size_t size)
+{
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		auto it = Entries.find(key);
+		if (it == Entries.end() || it->second.PayloadSize != size)
+			return false;
+	}
+
+	FILE* file = fopen(GetFilename(key).c_str(), "rb");
+	if (!file)
+		return false;
+
+	FileHeader header;
+	bool result = ReadHeader(file, key, header) && header.PayloadSize == size && header.Desc == desc && fread(dest, size, 1, file) == 1;
+	fclose(file);
+
+	// The files are never written to after they have been stored. Across restarts the entries are pruned in the order they were stored.
+	if (result)
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		Entries[key].LastUsed = (int64_t)time(nullptr);
+	}
+	return result;
+}
+
+void TextureDiskCache::Store(uint64_t key, const EntryDesc& desc, const void* data, size_t size)
+{
+	// Textures sharing the same data can be converted on several threads at once. Only the first one gets to write the entry.
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		if (!Storing.insert(key).second)
+			return;
+	}
+
+	FileHeader header;
+	header.Magic = FileMagic;
+	header.Version = FileVersion;
+	header.Key = key;
+	header.PayloadSize = size;
+	header.LastUsed = (int64_t)time(nullptr);
+	header.Desc = desc;
+
+	// Write to a temporary file first so that an interrupted write never leaves a truncated entry behind
+	std::string filename = GetFilename(key);
+	std::string tmpfilename = filename + ".tmp";
+	bool result = false;
+	FILE* file = fopen(tmpfilename.c_str(), "wb");
+	if (file)
+	{
+		result = fwrite(&header, sizeof(FileHeader), 1, file) == 1 && fwrite(data, size, 1, file) == 1;
+		result = (fclose(file) == 0) && result;
+
+		remove(filename.c_str());
+		if (!result || rename(tmpfilename.c_str(), filename.c_str()) != 0)
+		{
+			remove(tmpfilename.c_str());
+			result = false;
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(Mutex);
+	Storing.erase(key);
+	if (result)
+	{
+		Entry& entry = Entries[key];
+		if (entry.PayloadSize != 0)
+			TotalSize -= entry.PayloadSize + sizeof(FileHeader);
+		entry.PayloadSize = size;
+		entry.LastUsed = header.LastUsed;
+		TotalSize += size + sizeof(FileHeader);
+	}
+}
+
+void TextureDiskCache::Prune()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	if (TotalSize <= MaxSize)
+		return;
+
+	std::vector<std::pair<int64_t, uint64_t>> order;
+	order.reserve(Entries.size());
+	for (const auto& it : Entries)
+		order.push_back({ it.second.LastUsed, it.first });
+	std::sort(order.begin(), order.end());
+
+	// Go a bit below the limit so that pruning doesn't happen again for every new entry
+	int64_t target = MaxSize / 10 * 9;
+	for (const auto& it : order)
+	{
+		if (TotalSize <= target)
+			break;
+
+		remove(GetFilename(it.second).c_str());
+		TotalSize -= Entries[it.second].PayloadSize + sizeof(FileHeader);
+		Entries.erase(it.second);
+	}
+}
+
+void TextureDiskCache::RemoveInvalidFile(const std::string& filename)
+{
+	// A file that can't be deleted still takes up room, so it counts toward the size limit
+	if (remove(filename.c_str()) != 0)
+		TotalSize += std::max(GFileManager->FileSize(appFromAnsi(filename.c_str())), 0);
+}
+
+bool TextureDiskCache::ReadHeader(FILE* file, uint64_t key, FileHeader& header)
+{
+	return fread(&header, sizeof(FileHeader), 1, file) == 1 && header.Magic == FileMagic && header.Version == FileVersion && header.Key == key;
+}
+
+void TextureDiskCache::EntryDesc::AddMip(int width, int height)
+{
+	if (MipCount < MaxMips)
+	{
+		MipWidth[MipCount] = width;
+		MipHeight[MipCount] = height;
+	}
+	MipCount++;
+}
+
+std::string TextureDiskCache::GetFilename(uint64_t key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+	return Directory + name;
+}
+
+uint64_t TextureDiskCache::Hash(const void* data, size_t size, uint64_t seed)
+{
+	const uint64_t prime = 0x9E3779B97F4A7C15ULL;
+	const uint8_t* bytes = (const uint8_t*)data;
+
+	uint64_t h = seed ^ (size * prime);
+	while (size >= 8)
+	{
+		uint64_t v;
+		memcpy(&v, bytes, 8);
+		v *= 0xBF58476D1CE4E5B9ULL;
+		v ^= v >> 31;
+		h = (h ^ v) * prime;
+		h ^= h >> 29;
+		bytes += 8;
+		size -= 8;
+	}
+	while (size > 0)
+	{
+		h = (h ^ *bytes) * prime;
+		bytes++;
+		size--;
+	}
+	h ^= h >> 32;
+	return h;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <unordered_set>
+
+// Directory of compressed texture payloads keyed by a hash of their source data.
+// Load and Store may be called from the upload worker threads. Prune must be called from the render thread while no jobs are running.
+class TextureDiskCache
+{
+public:
+	TextureDiskCache(const std::string& directory, int64_t maxSize);
+
+	// What a payload was converted from. Stored with the entry and compared on load, so that two textures whose hashes collide don't share a payload.
+	struct EntryDesc
+	{
+		EntryDesc(uint32_t format, uint32_t uploadFormat, bool masked) : Format(format), UploadFormat(uploadFormat), Masked(masked ? 1 : 0) { }
+		EntryDesc() = default;
+
+		// Mips past MaxMips still count, but their size isn't compared
+		void AddMip(int width, int height);
+		bool operator==(const EntryDesc& other) const { return memcmp(this, &other, sizeof(EntryDesc)) == 0; }
+
+		enum { MaxMips = 16 };
+
+		uint32_t Format = 0;
+		uint32_t UploadFormat = 0;
+		uint32_t Masked = 0;
+		uint32_t MipCount = 0;
+		uint32_t MipWidth[MaxMips] = {};
+		uint32_t MipHeight[MaxMips] = {};
+	};
+
+	// Reads the payload for the key into dest. Returns false if there is no entry of that size and description.
+	bool Load(uint64_t key, const EntryDesc& desc, void* dest, size_t size);
+
+	// Does nothing if another thread is already storing the same key
+	void Store(uint64_t key, const EntryDesc& desc, const void* data, size_t size);
+
+	// Deletes the least recently used entries if the cache grew past its size limit
+	void Prune();
+
+	static uint64_t Hash(const void* data, size_t size, uint64_t seed);
+
+private:
+	struct FileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t Key;
+		uint64_t PayloadSize;
+		int64_t LastUsed;
+		EntryDesc Desc;
+	};
+
+	struct Entry
+	{
+		uint64_t PayloadSize = 0;
+		int64_t LastUsed = 0;
+	};
+
+	enum { FileMagic = 0x43544b56, FileVersion = 2 }; // "VKTC"
+
+	std::string GetFilename(uint64_t key) const;
+	void RemoveInvalidFile(const std::string& filename);
+	bool ReadHeader(FILE* file, uint64_t key, FileHeader& header);
+
+	std::string Directory;
+	int64_t MaxSize = 0;
+
+	std::mutex Mutex;
+	std::unordered_map<uint64_t, Entry> Entries;
+	std::unordered_set<uint64_t> Storing;
+	int64_t TotalSize = 0;
+};
@@ -8,6 +8,10 @@ TextureManager::TextureManager(UVulkanRenderDevice* renderer) : renderer(rendere
 {
 	CreateNullTexture();
 	CreateDitherTexture();
+	if (renderer->VkPalettedTextures)
+		CreatePaletteAtlas();
+	if (renderer->VkLightmapAtlas)
+		Lightmaps.reset(new LightmapAtlas(renderer));
 }
 
 TextureManager::~TextureManager()
@@ -16,10 +20,10 @@ TextureManager::~TextureManager()
 
 void TextureManager::UpdateTextureRect(FTextureInfo* info, int x, int y, int w, int h)
 {
-	std::unique_ptr<CachedTexture>& tex = TextureCache[0][info->CacheID];
+	CachedTexture* tex = TextureCache[0].Find(info->CacheID);
 	if (tex)
 	{
-		renderer->Uploads->UploadTextureRect(tex.get(), *info, x, y, w, h);
+		renderer->Uploads->UploadTextureRect(tex, *info, x, y, w, h);
 		info->bRealtimeChanged = 0;
 	}
 }
@@ -35,11 +39,17 @@ CachedTexture* TextureManager::GetTexture(FTextureInfo* info, bool masked)
 	if (info->Format != TEXF_P8)
 		masked = false;
 
-	std::unique_ptr<CachedTexture>& tex = TextureCache[(int)masked][info->CacheID];
+	// Palette index textures are shared between the masked and unmasked variants. The shader applies the masked rule.
+	bool paletted = PaletteAtlas && info->Format == TEXF_P8;
+
+	TextureCacheMap& cache = TextureCache[(int)(masked && !paletted)];
+	CachedTexture* tex = cache.Find(info->CacheID);
 	if (!tex)
 	{
-		tex.reset(new CachedTexture());
-		renderer->Uploads->UploadTexture(tex.get(), *info, masked);
+		tex = cache.Insert(info->CacheID, std::make_unique<CachedTexture>());
+		tex->Paletted = paletted;
+		tex->AlwaysMasked = info->Texture && (info->Texture->PolyFlags & PF_Masked);
+		renderer->Uploads->UploadTexture(tex, *info, masked);
 	}
 #if defined(OLDUNREAL469SDK)
 	else if (info->bRealtimeChanged && (!info->Texture || info->Texture->RealtimeChangeCount != tex->RealtimeChangeCount))
@@ -47,24 +57,58 @@ CachedTexture* TextureManager::GetTexture(FTextureInfo* info, bool masked)
 		if (info->Texture)
 			info->Texture->RealtimeChangeCount = tex->RealtimeChangeCount;
 		info->bRealtimeChanged = 0;
-		renderer->Uploads->UploadTexture(tex.get(), *info, masked);
+		renderer->Uploads->UploadTexture(tex, *info, masked);
 	}
 #else
 	else if (info->bRealtimeChanged)
 	{
 		info->bRealtimeChanged = 0;
-		renderer->Uploads->UploadTexture(tex.get(), *info, masked);
+		renderer->Uploads->UploadTexture(tex, *info, masked);
 	}
 #endif
-	return tex.get();
+
+	if (tex->Paletted && (tex->PaletteGeneration != PaletteGeneration || tex->PaletteCacheID != info->PaletteCacheID))
+	{
+		tex->PaletteRow = GetPaletteRow(info);
+		tex->PaletteCacheID = info->PaletteCacheID;
+		tex->PaletteGeneration = PaletteGeneration;
+	}
+
+	tex->LastUsedFrame = FrameIndex;
+	return tex;
+}
+
+LightmapLocation TextureManager::GetLightmap(FTextureInfo* info)
+{
+	LightmapLocation location;
+	if (!info)
+		return location;
+
+	if (Lightmaps && Lightmaps->GetLocation(info, FrameIndex, location))
+		return location;
+
+	location.Texture = GetTexture(info, false);
+	location.TextureWidth = info->USize;
+	location.TextureHeight = info->VSize;
+	return location;
 }
 
 void TextureManager::ClearCache()
 {
 	for (auto& cache : TextureCache)
 	{
-		cache.clear();
+		for (auto& it : cache)
+			ReleaseImage(it.Value.get());
+		cache.Clear();
 	}
+
+	PaletteRows.clear();
+	FreePaletteRows.clear();
+	NextPaletteRow = 0;
+	PaletteGeneration++;
+
+	if (Lightmaps)
+		Lightmaps->Clear();
 }
 
 void TextureManager::ClearAllBindlessIndexes()
@@ -72,11 +116,249 @@ void TextureManager::ClearAllBindlessIndexes()
 	for (auto& cache : TextureCache)
 	{
 		for (auto& it : cache)
+			it.Value->BindlessIndex = -1;
+	}
+
+	if (Lightmaps)
+		Lightmaps->ClearAllBindlessIndexes();
+}
+
+void TextureManager::EvictTextures(float budgetFraction)
+{
+	FrameIndex++;
+
+	// VMA only refreshes its budget numbers when the frame index changes
+	vmaSetCurrentFrameIndex(renderer->Device->allocator, (uint32_t)FrameIndex);
+
+	if (budgetFraction <= 0.0f)
+		return;
+
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS] = {};
+	vmaGetHeapBudgets(renderer->Device->allocator, budgets);
+
+	VkDeviceSize overBudget = 0;
+	const VkPhysicalDeviceMemoryProperties& memoryProperties = renderer->Device->PhysicalDevice.Properties.Memory;
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+	{
+		if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+		{
+			VkDeviceSize limit = (VkDeviceSize)(budgets[i].budget * (double)budgetFraction);
+			if (budgets[i].usage > limit)
+				overBudget = std::max(overBudget, budgets[i].usage - limit);
+		}
+	}
+
+	if (overBudget == 0)
+		return;
+
+	// Pooled images are the cheapest to give up
+	VkDeviceSize freed = ImagePoolSize;
+	FreeImagePool();
+	if (freed >= overBudget)
+		return;
+
+	struct EvictCandidate
+	{
+		int cache;
+		QWORD cacheID;
+		uint64_t lastUsedFrame;
+	};
+
+	std::vector<EvictCandidate> candidates;
+	for (int i = 0; i < 2; i++)
+	{
+		for (auto& it : TextureCache[i])
 		{
-			for (int& index : it.second->BindlessIndex)
-				index = -1;
+			CachedTexture* tex = it.Value.get();
+			if (!tex->inPendingUploads && tex->LastUsedFrame + MinEvictionAge < FrameIndex)
+				candidates.push_back({ i, it.Key, tex->LastUsedFrame });
 		}
 	}
+
+	std::sort(candidates.begin(), candidates.end(), [](const EvictCandidate& a, const EvictCandidate& b) { return a.lastUsedFrame < b.lastUsedFrame; });
+
+	for (const EvictCandidate& candidate : candidates)
+	{
+		if (freed >= overBudget)
+			break;
+
+		std::unique_ptr<CachedTexture> tex = TextureCache[candidate.cache].Remove(candidate.cacheID);
+
+		freed += tex->AllocatedBytes;
+		TexturesEvicted++;
+
+		renderer->Uploads->CancelStreaming(tex.get());
+
+		// The GPU may still be using the image from the last submit
+		renderer->DescriptorSets->ReleaseTextureArrayIndex(tex.get());
+		renderer->Commands->FrameDeleteList->imageViews.push_back(std::move(tex->imageView));
+		renderer->Commands->FrameDeleteList->images.push_back(std::move(tex->image));
+	}
+}
+
+void TextureManager::ReleaseImage(CachedTexture* tex)
+{
+	if (!tex->image || tex->ImageFormat == VK_FORMAT_UNDEFINED || tex->ResidentMip != 0 || tex->AllocatedBytes > MaxPooledImageSize || ImagePoolSize + tex->AllocatedBytes > MaxImagePoolSize)
+		return;
+
+	PooledImage image;
+	image.Key = { tex->ImageFormat, tex->ViewFormat, tex->image->width, tex->image->height, tex->image->mipLevels, tex->ImageUsage };
+	image.Image = std::move(tex->image);
+	image.ImageView = std::move(tex->imageView);
+	image.AllocatedBytes = tex->AllocatedBytes;
+	ImagePoolSize += image.AllocatedBytes;
+	ImagePool[image.Key].push_back(std::move(image));
+}
+
+bool TextureManager::ReuseImage(CachedTexture* tex, VkFormat imageFormat, VkFormat viewFormat, int width, int height, int mipLevels, VkImageUsageFlags usage)
+{
+	ImagePoolKey key = { imageFormat, viewFormat, width, height, mipLevels, usage };
+	auto it = ImagePool.find(key);
+	if (it == ImagePool.end())
+		return false;
+
+	PooledImage& image = it->second.back();
+	tex->image = std::move(image.Image);
+	tex->imageView = std::move(image.ImageView);
+	tex->AllocatedBytes = image.AllocatedBytes;
+	tex->imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	ImagePoolSize -= image.AllocatedBytes;
+
+	it->second.pop_back();
+	if (it->second.empty())
+		ImagePool.erase(it);
+
+	ImagesReused++;
+	return true;
+}
+
+void TextureManager::FreeImagePool()
+{
+	for (auto& it : ImagePool)
+	{
+		for (PooledImage& image : it.second)
+		{
+			renderer->Commands->FrameDeleteList->imageViews.push_back(std::move(image.ImageView));
+			renderer->Commands->FrameDeleteList->images.push_back(std::move(image.Image));
+		}
+	}
+	ImagePool.clear();
+	ImagePoolSize = 0;
+}
+
+void TextureManager::GetCacheStats(std::map<VkFormat, CacheStats>& formats, std::map<std::string, CacheStats>& buckets)
+{
+	auto add = [&](const char* bucket, VkFormat format, VkDeviceSize bytes)
+	{
+		CacheStats& f = formats[format];
+		f.Count++;
+		f.Bytes += bytes;
+		CacheStats& b = buckets[bucket];
+		b.Count++;
+		b.Bytes += bytes;
+	};
+
+	static const char* cacheNames[2] = { "Unmasked", "Masked" };
+	for (int i = 0; i < 2; i++)
+	{
+		for (auto& it : TextureCache[i])
+		{
+			if (it.Value->image)
+				add(cacheNames[i], it.Value->ViewFormat, it.Value->AllocatedBytes);
+		}
+	}
+
+	if (Lightmaps)
+	{
+		for (int i = 0; i < Lightmaps->GetPageCount(); i++)
+		{
+			CachedTexture* page = Lightmaps->GetPageTexture(i);
+			add("LightmapAtlas", page->ViewFormat, page->AllocatedBytes);
+		}
+	}
+
+	if (PaletteAtlas)
+		add("PaletteAtlas", PaletteAtlas->ViewFormat, PaletteAtlas->AllocatedBytes);
+
+	for (auto& it : ImagePool)
+	{
+		for (PooledImage& image : it.second)
+			add("ImagePool", image.Key.ViewFormat, image.AllocatedBytes);
+	}
+}
+
+int TextureManager::GetPaletteRow(FTextureInfo* info)
+{
+	auto it = PaletteRows.find(info->PaletteCacheID);
+	if (it != PaletteRows.end())
+		return it->second;
+
+	if (FreePaletteRows.empty() && NextPaletteRow == MaxPaletteRows)
+		RecyclePaletteRows();
+
+	int row;
+	if (!FreePaletteRows.empty())
+	{
+		row = FreePaletteRows.back();
+		FreePaletteRows.pop_back();
+	}
+	else if (NextPaletteRow < MaxPaletteRows)
+	{
+		row = NextPaletteRow++;
+	}
+	else
+	{
+		// Every row is used by this frame alone. Start over, although anything already drawn this frame may show the wrong colors.
+		static bool firstCall = true;
+		if (firstCall)
+		{
+			debugf(TEXT("VulkanDrv encountered more than %d palettes in a single frame"), (int)MaxPaletteRows);
+			firstCall = false;
+		}
+		PaletteRows.clear();
+		PaletteGeneration++;
+		NextPaletteRow = 1;
+		row = 0;
+	}
+
+	PaletteRows[info->PaletteCacheID] = row;
+	renderer->Uploads->UploadPalette(PaletteAtlas.get(), row, info->Palette);
+	return row;
+}
+
+void TextureManager::RecyclePaletteRows()
+{
+	// The earlier frames are done on the GPU, but draws from this frame may not have executed yet.
+	// Keep the rows of the textures used this frame and hand out the rest again.
+	std::vector<bool> inUse(MaxPaletteRows, false);
+	int oldGeneration = PaletteGeneration++;
+	for (auto& cache : TextureCache)
+	{
+		for (auto& it : cache)
+		{
+			CachedTexture* tex = it.Value.get();
+			if (tex->Paletted && tex->PaletteGeneration == oldGeneration && tex->LastUsedFrame == FrameIndex)
+			{
+				inUse[tex->PaletteRow] = true;
+				tex->PaletteGeneration = PaletteGeneration;
+			}
+		}
+	}
+
+	for (auto it = PaletteRows.begin(); it != PaletteRows.end();)
+	{
+		if (!inUse[it->second])
+			it = PaletteRows.erase(it);
+		else
+			++it;
+	}
+
+	FreePaletteRows.clear();
+	for (int row = MaxPaletteRows - 1; row >= 0; row--)
+	{
+		if (!inUse[row])
+			FreePaletteRows.push_back(row);
+	}
 }
 
 void TextureManager::CreateNullTexture()
@@ -122,6 +404,25 @@ void TextureManager::CreateNullTexture()
 	renderer->Commands->FrameDeleteList->buffers.push_back(std::move(stagingbuffer));
 }
 
+void TextureManager::CreatePaletteAtlas()
+{
+	PaletteAtlas.reset(new CachedTexture());
+	PaletteAtlas->ImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	PaletteAtlas->ViewFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+	PaletteAtlas->image = ImageBuilder()
+		.Format(VK_FORMAT_R8G8B8A8_UNORM)
+		.Size(256, MaxPaletteRows)
+		.Usage(VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
+		.DebugName("PaletteAtlas")
+		.Create(renderer->Device.get(), &PaletteAtlas->AllocatedBytes);
+
+	PaletteAtlas->imageView = ImageViewBuilder()
+		.Image(PaletteAtlas->image.get(), VK_FORMAT_R8G8B8A8_UNORM)
+		.DebugName("PaletteAtlasView")
+		.Create(renderer->Device.get());
+}
+
 void TextureManager::CreateDitherTexture()
 {
 	static const float ditherdata[64] =
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "SceneTextures.h"
+#include "LightmapAtlas.h"
+#include "TextureCacheMap.h"
 
 struct FTextureInfo;
 class UVulkanRenderDevice;
@@ -15,9 +17,18 @@ public:
 	void UpdateTextureRect(FTextureInfo* info, int x, int y, int w, int h);
 	CachedTexture* GetTexture(FTextureInfo* info, bool masked);
 
+	// Lightmaps and fogmaps are placed in the atlas when it is enabled and has room for them
+	LightmapLocation GetLightmap(FTextureInfo* info);
+
 	void ClearCache();
 	void ClearAllBindlessIndexes();
 
+	// Evicts the least recently used textures if the device local heaps are using more than the given fraction of their budget
+	void EvictTextures(float budgetFraction);
+
+	// Gives the texture a previously released image matching the description. Returns false if there is none.
+	bool ReuseImage(CachedTexture* tex, VkFormat imageFormat, VkFormat viewFormat, int width, int height, int mipLevels, VkImageUsageFlags usage);
+
 	std::unique_ptr<VulkanImage> NullTexture;
 	std::unique_ptr<VulkanImageView> NullTextureView;
 
@@ -26,12 +37,76 @@ public:
 
 	std::unique_ptr<SceneTextures> Scene;
 
-	int GetTexturesInCache() { return TextureCache[0].size() + TextureCache[1].size(); }
+	// 256 wide RGBA image with one palette per row, used by textures uploaded as palette indexes
+	std::unique_ptr<CachedTexture> PaletteAtlas;
+
+	std::unique_ptr<LightmapAtlas> Lightmaps;
+
+	int GetTexturesInCache() { return (int)(TextureCache[0].Size() + TextureCache[1].Size()); }
+	int GetTexturesEvicted() const { return TexturesEvicted; }
+	int GetImagesReused() const { return ImagesReused; }
+
+	struct CacheStats
+	{
+		int Count = 0;
+		VkDeviceSize Bytes = 0;
+	};
+
+	// Texture count and allocated bytes by view format and by where the texture is kept (cache bucket, atlas or image pool)
+	void GetCacheStats(std::map<VkFormat, CacheStats>& formats, std::map<std::string, CacheStats>& buckets);
 
 private:
 	void CreateNullTexture();
 	void CreateDitherTexture();
+	void CreatePaletteAtlas();
+	int GetPaletteRow(FTextureInfo* info);
+	void RecyclePaletteRows();
+	void ReleaseImage(CachedTexture* tex);
+	void FreeImagePool();
 
 	UVulkanRenderDevice* renderer = nullptr;
-	std::unordered_map<QWORD, std::unique_ptr<CachedTexture>> TextureCache[2];
+	TextureCacheMap TextureCache[2];
+
+	// Textures used within this many frames are never evicted, to avoid thrashing when everything visible doesn't fit
+	enum { MinEvictionAge = 120 };
+
+	uint64_t FrameIndex = 1;
+	int TexturesEvicted = 0;
+
+	// Images of cleared textures, kept around so that new textures of the same kind don't need a new image and allocation
+	struct ImagePoolKey
+	{
+		VkFormat ImageFormat;
+		VkFormat ViewFormat;
+		int Width;
+		int Height;
+		int MipLevels;
+		VkImageUsageFlags Usage;
+
+		bool operator<(const ImagePoolKey& other) const
+		{
+			return std::tie(ImageFormat, ViewFormat, Width, Height, MipLevels, Usage) < std::tie(other.ImageFormat, other.ViewFormat, other.Width, other.Height, other.MipLevels, other.Usage);
+		}
+	};
+
+	struct PooledImage
+	{
+		ImagePoolKey Key;
+		std::unique_ptr<VulkanImage> Image;
+		std::unique_ptr<VulkanImageView> ImageView;
+		VkDeviceSize AllocatedBytes = 0;
+	};
+
+	// Only small images are pooled, and only up to a total size
+	enum { MaxPooledImageSize = 1024 * 1024, MaxImagePoolSize = 64 * 1024 * 1024 };
+
+	std::map<ImagePoolKey, std::vector<PooledImage>> ImagePool;
+	VkDeviceSize ImagePoolSize = 0;
+	int ImagesReused = 0;
+
+	enum { MaxPaletteRows = 4095 };
+	std::unordered_map<QWORD, int> PaletteRows;
+	std::vector<int> FreePaletteRows;
+	int NextPaletteRow = 0;
+	int PaletteGeneration = 1;
 };
@@ -1,11 +1,36 @@
 
 #include "Precomp.h"
 #include "TextureUploader.h"
+#include "TextureCompressor.h"
 
 #ifdef USE_SSE2
 #include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
 #endif
 
+TextureUploader* TextureUploader::GetPaletteIndexUploader()
+{
+	static TextureUploader_Simple Uploader(VK_FORMAT_R8_UINT, 1);
+	return &Uploader;
+}
+
+TextureUploader* TextureUploader::GetCompressedUploader(TextureUploader* source, bool alpha)
+{
+	if (source->GetVkFormat() != VK_FORMAT_R8G8B8A8_UNORM && source->GetVkFormat() != VK_FORMAT_B8G8R8A8_UNORM)
+		return nullptr;
+
+	static std::map<std::pair<TextureUploader*, bool>, std::unique_ptr<TextureUploader>> Uploaders;
+	std::unique_ptr<TextureUploader>& uploader = Uploaders[{ source, alpha }];
+	if (!uploader)
+		uploader.reset(new TextureUploader_Compressed(source, alpha));
+	return uploader.get();
+}
+
 TextureUploader* TextureUploader::GetUploader(ETextureFormat format)
 {
 	static std::map<ETextureFormat, std::unique_ptr<TextureUploader>> Uploaders;
@@ -190,40 +215,117 @@ TextureUploader* TextureUploader::GetUploader(ETextureFormat format)
 
 /////////////////////////////////////////////////////////////////////////////
 
+static void ExpandPalette_Scalar(uint32_t* dst, const BYTE* src, int count, const uint32_t* table)
+{
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		uint32_t c0 = table[src[i]];
+		uint32_t c1 = table[src[i + 1]];
+		uint32_t c2 = table[src[i + 2]];
+		uint32_t c3 = table[src[i + 3]];
+		dst[i] = c0;
+		dst[i + 1] = c1;
+		dst[i + 2] = c2;
+		dst[i + 3] = c3;
+	}
+	for (; i < count; i++)
+	{
+		dst[i] = table[src[i]];
+	}
+}
+
+#ifdef USE_SSE2
+
+AVX2_TARGET static void ExpandPalette_AVX2(uint32_t* dst, const BYTE* src, int count, const uint32_t* table)
+{
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i indexes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i)));
+		__m256i colors = _mm256_i32gather_epi32((const int*)table, indexes, 4);
+		_mm256_storeu_si256((__m256i*)(dst + i), colors);
+	}
+	ExpandPalette_Scalar(dst + i, src + i, count - i, table);
+}
+
+static bool CPUSupportsAVX2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	// The OS must also save the YMM registers
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+std::vector<std::pair<const char*, PaletteExpandFunc>> TextureUploader_P8::GetExpandFuncs()
+{
+	std::vector<std::pair<const char*, PaletteExpandFunc>> funcs;
+	funcs.push_back({ "scalar", ExpandPalette_Scalar });
+#ifdef USE_SSE2
+	if (CPUSupportsAVX2())
+		funcs.push_back({ "AVX2", ExpandPalette_AVX2 });
+#endif
+	return funcs;
+}
+
+static PaletteExpandFunc GetPaletteExpandFunc()
+{
+	// Uploads run on the worker threads, so let the static initialization guard pick the kernel once
+	static PaletteExpandFunc func = TextureUploader_P8::GetExpandFuncs().back().second;
+	return func;
+}
+
+void TextureUploader_P8::GetExpandTable(uint32_t* table, const FColor* palette, bool masked)
+{
+	static_assert(sizeof(FColor) == sizeof(uint32_t), "FColor must be 32 bits");
+
+	// Masked textures use palette index 0 as the transparent color
+	memcpy(table, palette, 256 * sizeof(uint32_t));
+	if (masked)
+		table[0] = 0;
+}
+
 int TextureUploader_P8::GetUploadSize(int x, int y, int w, int h)
 {
 	return w * h * 4;
 }
 
+int TextureUploader_P8::GetSourceSize(int w, int h)
+{
+	return w * h;
+}
+
 void TextureUploader_P8::UploadRect(void* d, FMipmapBase* mip, int x, int y, int w, int h, FColor* palette, bool masked)
 {
+	uint32_t table[256];
+	GetExpandTable(table, palette, masked);
+
+	PaletteExpandFunc expand = GetPaletteExpandFunc();
+
 	int pitch = mip->USize;
 	BYTE* src = mip->DataPtr + x + y * pitch;
-	FColor* Ptr = (FColor*)d;
-	if (masked)
-	{
-		FColor translucent(0, 0, 0, 0);
-		for (int i = 0; i < h; i++)
-		{
-			for (int j = 0; j < w; j++)
-			{
-				int idx = src[j];
-				*Ptr++ = (idx != 0) ? palette[idx] : translucent;
-			}
-			src += pitch;
-		}
-	}
-	else
+	uint32_t* dst = (uint32_t*)d;
+	for (int i = 0; i < h; i++)
 	{
-		for (int i = 0; i < h; i++)
-		{
-			for (int j = 0; j < w; j++)
-			{
-				int idx = src[j];
-				*Ptr++ = palette[idx];
-			}
-			src += pitch;
-		}
+		expand(dst, src, w, table);
+		dst += w;
+		src += pitch;
 	}
 }
 
@@ -269,10 +371,10 @@ void TextureUploader_BGRA8_LM::UploadRect(void* dst, FMipmapBase* mip, int x, in
 			for (int j = 0; j < w; j++)
 			{
 				FColor Src = src[j];
-				Ptr->R = Src.B << 1;
-				Ptr->G = Src.G << 1;
-				Ptr->B = Src.R << 1;
-				Ptr->A = Src.A << 1;
+				Ptr->R = std::min(Src.B << 1, 255);
+				Ptr->G = std::min(Src.G << 1, 255);
+				Ptr->B = std::min(Src.R << 1, 255);
+				Ptr->A = std::min(Src.A << 1, 255);
 				Ptr++;
 			}
 			src += pitch;
@@ -287,10 +389,10 @@ void TextureUploader_BGRA8_LM::UploadRect(void* dst, FMipmapBase* mip, int x, in
 		for (int j = 0; j < w; j++)
 		{
 			FColor Src = src[j];
-			Ptr->R = Src.B << 1;
-			Ptr->G = Src.G << 1;
-			Ptr->B = Src.R << 1;
-			Ptr->A = Src.A << 1;
+			Ptr->R = std::min(Src.B << 1, 255);
+			Ptr->G = std::min(Src.G << 1, 255);
+			Ptr->B = std::min(Src.R << 1, 255);
+			Ptr->A = std::min(Src.A << 1, 255);
 			Ptr++;
 		}
 		src += pitch;
@@ -305,6 +407,11 @@ int TextureUploader_RGB10A2::GetUploadSize(int x, int y, int w, int h)
 	return w * h * 8;
 }
 
+int TextureUploader_RGB10A2::GetSourceSize(int w, int h)
+{
+	return w * h * 4;
+}
+
 void TextureUploader_RGB10A2::UploadRect(void* dst, FMipmapBase* mip, int x, int y, int w, int h, FColor* palette, bool masked)
 {
 	int pitch = mip->USize;
@@ -314,15 +421,16 @@ void TextureUploader_RGB10A2::UploadRect(void* dst, FMipmapBase* mip, int x, int
 	{
 		for (int j = 0; j < w; j++)
 		{
-			uint32_t c = *Ptr;
+			uint32_t c = src[j];
 			uint32_t r = (c >> 22) & 0x3ff;
 			uint32_t g = (c >> 12) & 0x3ff;
 			uint32_t b = (c >> 2) & 0x3ff;
 			uint32_t a = c & 0x3;
 
-			r = r * 0xffff / 0x3ff;
-			g = g * 0xffff / 0x3ff;
-			b = b * 0xffff / 0x3ff;
+			// Rounded to the nearest 16-bit value, like the GPU converts normalized values
+			r = (r * 0xffff + 0x1ff) / 0x3ff;
+			g = (g * 0xffff + 0x1ff) / 0x3ff;
+			b = (b * 0xffff + 0x1ff) / 0x3ff;
 			a = a * 0xffff / 0x3;
 
 			*(Ptr++) = r;
@@ -341,6 +449,11 @@ int TextureUploader_RGB10A2_UI::GetUploadSize(int x, int y, int w, int h)
 	return w * h * 8;
 }
 
+int TextureUploader_RGB10A2_UI::GetSourceSize(int w, int h)
+{
+	return w * h * 4;
+}
+
 void TextureUploader_RGB10A2_UI::UploadRect(void* dst, FMipmapBase* mip, int x, int y, int w, int h, FColor* palette, bool masked)
 {
 	int pitch = mip->USize;
@@ -350,7 +463,7 @@ void TextureUploader_RGB10A2_UI::UploadRect(void* dst, FMipmapBase* mip, int x,
 	{
 		for (int j = 0; j < w; j++)
 		{
-			uint32_t c = *Ptr;
+			uint32_t c = src[j];
 			uint32_t r = (c >> 22) & 0x3ff;
 			uint32_t g = (c >> 12) & 0x3ff;
 			uint32_t b = (c >> 2) & 0x3ff;
@@ -372,6 +485,11 @@ int TextureUploader_RGB10A2_LM::GetUploadSize(int x, int y, int w, int h)
 	return w * h * 8;
 }
 
+int TextureUploader_RGB10A2_LM::GetSourceSize(int w, int h)
+{
+	return w * h * 4;
+}
+
 void TextureUploader_RGB10A2_LM::UploadRect(void* dst, FMipmapBase* mip, int x, int y, int w, int h, FColor* palette, bool masked)
 {
 	int pitch = mip->USize;
@@ -381,16 +499,17 @@ void TextureUploader_RGB10A2_LM::UploadRect(void* dst, FMipmapBase* mip, int x,
 	{
 		for (int j = 0; j < w; j++)
 		{
-			uint32_t c = *Ptr;
+			uint32_t c = src[j];
 			uint32_t r = (c >> 22) & 0x3ff;
 			uint32_t g = (c >> 12) & 0x3ff;
 			uint32_t b = (c >> 2) & 0x3ff;
 			uint32_t a = c & 0x3;
 
-			r = (r << 1) * 0xffff / 0xff;
-			g = (g << 1) * 0xffff / 0xff;
-			b = (b << 1) * 0xffff / 0xff;
-			a = (a << 1) * 0xffff / 0x3;
+			// Lightmaps are stored at half brightness. Twice the 10-bit value saturates at full intensity.
+			r = std::min((r * 2 * 0xffff + 0x1ff) / 0x3ff, 0xffffu);
+			g = std::min((g * 2 * 0xffff + 0x1ff) / 0x3ff, 0xffffu);
+			b = std::min((b * 2 * 0xffff + 0x1ff) / 0x3ff, 0xffffu);
+			a = std::min(a * 2 * 0xffff / 0x3, 0xffffu);
 
 			*(Ptr++) = r;
 			*(Ptr++) = g;
@@ -453,6 +572,61 @@ void TextureUploader_4x4Block::UploadRect(void* d, FMipmapBase* mip, int x, int
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+
+int TextureUploader_Compressed::GetUploadSize(int x, int y, int w, int h)
+{
+	int x0 = x / 4;
+	int y0 = y / 4;
+	int x1 = (x + w + 3) / 4;
+	int y1 = (y + h + 3) / 4;
+	return (x1 - x0) * (y1 - y0) * (Alpha ? 16 : 8);
+}
+
+int TextureUploader_Compressed::GetSourceSize(int w, int h)
+{
+	return Source->GetSourceSize(w, h);
+}
+
+void TextureUploader_Compressed::UploadRect(void* d, FMipmapBase* mip, int x, int y, int w, int h, FColor* palette, bool masked)
+{
+	int x0 = x / 4;
+	int y0 = y / 4;
+	int x1 = (x + w + 3) / 4;
+	int y1 = (y + h + 3) / 4;
+
+	// Convert the covered blocks to 32-bit pixels first. Blocks that extend past the mip edge repeat the last row and column.
+	int px = x0 * 4;
+	int py = y0 * 4;
+	int pw = std::min(x1 * 4, (int)mip->USize) - px;
+	int ph = std::min(y1 * 4, (int)mip->VSize) - py;
+	std::vector<uint32_t> pixels(pw * ph);
+	Source->UploadRect(pixels.data(), mip, px, py, pw, ph, palette, masked);
+
+	int redIndex = (Source->GetVkFormat() == VK_FORMAT_B8G8R8A8_UNORM) ? 2 : 0;
+	int blockSize = Alpha ? 16 : 8;
+	uint8_t* dst = (uint8_t*)d;
+	uint32_t block[16];
+	for (int by = 0; by < y1 - y0; by++)
+	{
+		for (int bx = 0; bx < x1 - x0; bx++)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				int sx = std::min(bx * 4 + (i & 3), pw - 1);
+				int sy = std::min(by * 4 + (i >> 2), ph - 1);
+				block[i] = pixels[sx + sy * pw];
+			}
+
+			if (Alpha)
+				CompressBlockBC3((const uint8_t*)block, redIndex, dst);
+			else
+				CompressBlockBC1((const uint8_t*)block, redIndex, masked, dst);
+			dst += blockSize;
+		}
+	}
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 int TextureUploader_2DBlock::GetUploadSize(int x, int y, int w, int h)
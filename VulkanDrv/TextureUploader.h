@@ -13,14 +13,27 @@ public:
 	virtual int GetUploadSize(int x, int y, int w, int h) = 0;
 	virtual void UploadRect(void* dst, FMipmapBase* mip, int x, int y, int w, int h, FColor* palette, bool masked) = 0;
 
+	// Size of the mip data UploadRect reads for a whole w x h mip
+	virtual int GetSourceSize(int w, int h) { return GetUploadSize(0, 0, w, h); }
+
 	VkFormat GetVkFormat() const { return Format; }
 
+	// True if the uploaded data is the mip data as-is
+	virtual bool IsDirectCopy() const { return false; }
+
 	static TextureUploader* GetUploader(ETextureFormat format);
+	static TextureUploader* GetPaletteIndexUploader();
+
+	// Returns an uploader compressing the output of an RGBA8 or BGRA8 uploader to BC1 or BC3, or nullptr if the source format can't be compressed
+	static TextureUploader* GetCompressedUploader(TextureUploader* source, bool alpha);
 
 private:
 	VkFormat Format;
 };
 
+// Looks up count palette indexes in a 256 entry table
+typedef void(*PaletteExpandFunc)(uint32_t* dst, const BYTE* src, int count, const uint32_t* table);
+
 class TextureUploader_P8 : public TextureUploader
 {
 public:
@@ -28,6 +41,11 @@ public:
 
 	int GetUploadSize(int x, int y, int w, int h) override;
 	void UploadRect(void* dst, FMipmapBase* mip, int x, int y, int w, int h, FColor* palette, bool masked) override;
+	int GetSourceSize(int w, int h) override;
+
+	// The lookup kernels this CPU can run, named and starting with the scalar one. UploadRect uses the last one.
+	static std::vector<std::pair<const char*, PaletteExpandFunc>> GetExpandFuncs();
+	static void GetExpandTable(uint32_t* table, const FColor* palette, bool masked);
 };
 
 class TextureUploader_BGRA8_LM : public TextureUploader
@@ -46,6 +64,7 @@ public:
 
 	int GetUploadSize(int x, int y, int w, int h) override;
 	void UploadRect(void* dst, FMipmapBase* mip, int x, int y, int w, int h, FColor* palette, bool masked) override;
+	int GetSourceSize(int w, int h) override;
 };
 
 class TextureUploader_RGB10A2_UI : public TextureUploader
@@ -55,6 +74,7 @@ public:
 
 	int GetUploadSize(int x, int y, int w, int h) override;
 	void UploadRect(void* dst, FMipmapBase* mip, int x, int y, int w, int h, FColor* palette, bool masked) override;
+	int GetSourceSize(int w, int h) override;
 };
 
 class TextureUploader_RGB10A2_LM : public TextureUploader
@@ -64,6 +84,7 @@ public:
 
 	int GetUploadSize(int x, int y, int w, int h) override;
 	void UploadRect(void* dst, FMipmapBase* mip, int x, int y, int w, int h, FColor* palette, bool masked) override;
+	int GetSourceSize(int w, int h) override;
 };
 
 class TextureUploader_Simple : public TextureUploader
@@ -73,6 +94,7 @@ public:
 
 	int GetUploadSize(int x, int y, int w, int h) override;
 	void UploadRect(void* dst, FMipmapBase* mip, int x, int y, int w, int h, FColor* palette, bool masked) override;
+	bool IsDirectCopy() const override { return true; }
 
 private:
 	int BytesPerPixel;
@@ -85,6 +107,7 @@ public:
 
 	int GetUploadSize(int x, int y, int w, int h) override;
 	void UploadRect(void* dst, FMipmapBase* mip, int x, int y, int w, int h, FColor* palette, bool masked) override;
+	bool IsDirectCopy() const override { return true; }
 
 private:
 	int BytesPerBlock;
@@ -103,3 +126,17 @@ private:
 	int BlockY;
 	int BytesPerBlock;
 };
+
+class TextureUploader_Compressed : public TextureUploader
+{
+public:
+	TextureUploader_Compressed(TextureUploader* source, bool alpha) : TextureUploader(alpha ? VK_FORMAT_BC3_UNORM_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK), Source(source), Alpha(alpha) { }
+
+	int GetUploadSize(int x, int y, int w, int h) override;
+	void UploadRect(void* dst, FMipmapBase* mip, int x, int y, int w, int h, FColor* palette, bool masked) override;
+	int GetSourceSize(int w, int h) override;
+
+private:
+	TextureUploader* Source;
+	bool Alpha;
+};
@@ -38,7 +38,7 @@ void UVulkanRenderDevice::StaticConstructor()
 	VolumetricLighting = 1;
 
 #if defined(OLDUNREAL469SDK)
-	UseLightmapAtlas = 0; // Note: do not turn this on. It does not work and generates broken fogmaps.
+	UseLightmapAtlas = 0; // Note: do not turn this on. It does not work and generates broken fogmaps. VkLightmapAtlas packs them in the driver instead.
 	SupportsUpdateTextureRect = 1;
 	MaxTextureSize = 4096;
 	NeedsMaskedFonts = 0;
@@ -72,6 +72,17 @@ void UVulkanRenderDevice::StaticConstructor()
 	VkDeviceIndex = 0;
 	VkDebug = 0;
 	VkExclusiveFullscreen = 0;
+	VkMemoryBudget = 0.9f;
+	VkPalettedTextures = 0;
+	VkCompressTextures = 0;
+	VkTextureCacheSize = 1024;
+	VkLightmapAtlas = 1;
+	VkMipStreamingBudget = 0;
+	VkDynamicResolution = 0;
+	VkDynamicResolutionTarget = 60;
+	VkPresentWait = 0;
+	VkMaxQueuedFrames = 0;
+	VkFrameRateLimit = 0;
 
 #if defined(OLDUNREAL469SDK)
 	new(GetClass(), TEXT("UseLightmapAtlas"), RF_Public) UBoolProperty(CPP_PROPERTY(UseLightmapAtlas), TEXT("Display"), CPF_Config);
@@ -117,6 +128,17 @@ void UVulkanRenderDevice::StaticConstructor()
 	new(GetClass(), TEXT("VkDeviceIndex"), RF_Public) UIntProperty(CPP_PROPERTY(VkDeviceIndex), TEXT("Display"), CPF_Config);
 	new(GetClass(), TEXT("VkDebug"), RF_Public) UBoolProperty(CPP_PROPERTY(VkDebug), TEXT("Display"), CPF_Config);
 	new(GetClass(), TEXT("VkExclusiveFullscreen"), RF_Public) UBoolProperty(CPP_PROPERTY(VkExclusiveFullscreen), TEXT("Display"), CPF_Config);
+	new(GetClass(), TEXT("VkMemoryBudget"), RF_Public) UFloatProperty(CPP_PROPERTY(VkMemoryBudget), TEXT("Display"), CPF_Config);
+	new(GetClass(), TEXT("VkPalettedTextures"), RF_Public) UBoolProperty(CPP_PROPERTY(VkPalettedTextures), TEXT("Display"), CPF_Config);
+	new(GetClass(), TEXT("VkCompressTextures"), RF_Public) UBoolProperty(CPP_PROPERTY(VkCompressTextures), TEXT("Display"), CPF_Config);
+	new(GetClass(), TEXT("VkTextureCacheSize"), RF_Public) UIntProperty(CPP_PROPERTY(VkTextureCacheSize), TEXT("Display"), CPF_Config);
+	new(GetClass(), TEXT("VkLightmapAtlas"), RF_Public) UBoolProperty(CPP_PROPERTY(VkLightmapAtlas), TEXT("Display"), CPF_Config);
+	new(GetClass(), TEXT("VkMipStreamingBudget"), RF_Public) UIntProperty(CPP_PROPERTY(VkMipStreamingBudget), TEXT("Display"), CPF_Config);
+	new(GetClass(), TEXT("VkDynamicResolution"), RF_Public) UBoolProperty(CPP_PROPERTY(VkDynamicResolution), TEXT("Display"), CPF_Config);
+	new(GetClass(), TEXT("VkDynamicResolutionTarget"), RF_Public) UIntProperty(CPP_PROPERTY(VkDynamicResolutionTarget), TEXT("Display"), CPF_Config);
+	new(GetClass(), TEXT("VkPresentWait"), RF_Public) UBoolProperty(CPP_PROPERTY(VkPresentWait), TEXT("Display"), CPF_Config);
+	new(GetClass(), TEXT("VkMaxQueuedFrames"), RF_Public) UIntProperty(CPP_PROPERTY(VkMaxQueuedFrames), TEXT("Display"), CPF_Config);
+	new(GetClass(), TEXT("VkFrameRateLimit"), RF_Public) UIntProperty(CPP_PROPERTY(VkFrameRateLimit), TEXT("Display"), CPF_Config);
 
 	unguard;
 }
@@ -192,10 +214,16 @@ UBOOL UVulkanRenderDevice::Init(UViewport* InViewport, INT NewX, INT NewY, INT N
 
 		deviceBuilder.RequireExtension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
 		deviceBuilder.RequireExtension(VK_KHR_SAMPLER_MIRROR_CLAMP_TO_EDGE_EXTENSION_NAME);
+		deviceBuilder.OptionalDynamicRendering();
+		deviceBuilder.OptionalHostImageCopy();
+		deviceBuilder.OptionalPresentWait();
+		deviceBuilder.OptionalExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 		deviceBuilder.SelectDevice(VkDeviceIndex);
 
 		Device = deviceBuilder.Create(instance);
 
+		UseDynamicRendering = Device->SupportsExtension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) && Device->EnabledFeatures.DynamicRendering.dynamicRendering;
+
 		bool supportsBindless =
 			Device->EnabledFeatures.DescriptorIndexing.descriptorBindingPartiallyBound &&
 			Device->EnabledFeatures.DescriptorIndexing.runtimeDescriptorArray &&
@@ -363,6 +391,7 @@ void UVulkanRenderDevice::Exit()
 
 	if (Device) vkDeviceWaitIdle(Device->device);
 
+	Capture.reset();
 	Framebuffers.reset();
 	RenderPasses.reset();
 	DescriptorSets.reset();
@@ -431,39 +460,12 @@ void UVulkanRenderDevice::Flush(UBOOL AllowPrecache)
 	if (IsLocked)
 	{
 		DrawBatch(Commands->GetDrawCommands());
-		Commands->GetDrawCommands()->endRenderPass();
+		EndScenePass(Commands->GetDrawCommands());
 		SubmitAndWait(false, 0, 0, false);
 
 		ClearTextureCache();
 
-		auto cmdbuffer = Commands->GetDrawCommands();
-
-		VkAccessFlags srcColorAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
-		VkAccessFlags dstColorAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
-		VkAccessFlags srcDepthAccess = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-		VkAccessFlags dstDepthAccess = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-		VkPipelineStageFlags srcStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-		VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-
-		PipelineBarrier()
-			.AddImage(Textures->Scene->ColorBuffer.get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, srcColorAccess, dstColorAccess)
-			.AddImage(Textures->Scene->HitBuffer.get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, srcColorAccess, dstColorAccess)
-			.AddImage(Textures->Scene->DepthBuffer.get(), VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, srcDepthAccess, dstDepthAccess, VK_IMAGE_ASPECT_DEPTH_BIT)
-			.Execute(cmdbuffer, srcStages, dstStages);
-
-		RenderPassBegin()
-			.RenderPass(RenderPasses->Scene.RenderPassContinue.get())
-			.Framebuffer(Framebuffers->SceneFramebuffer.get())
-			.RenderArea(0, 0, Textures->Scene->Width, Textures->Scene->Height)
-			.AddClearColor(0.0f, 0.0f, 0.0f, 0.0f)
-			.AddClearColor(0.0f, 0.0f, 0.0f, 0.0f)
-			.AddClearDepthStencil(1.0f, 0)
-			.Execute(cmdbuffer);
-
-		VkBuffer vertexBuffers[] = { Buffers->SceneVertexBuffer->buffer };
-		VkDeviceSize offsets[] = { 0 };
-		cmdbuffer->bindVertexBuffers(0, 1, vertexBuffers, offsets);
-		cmdbuffer->bindIndexBuffer(Buffers->SceneIndexBuffer->buffer, 0, VK_INDEX_TYPE_UINT32);
+		BeginScenePass(Commands->GetDrawCommands(), true);
 	}
 	else
 	{
@@ -568,6 +570,84 @@ UBOOL UVulkanRenderDevice::Exec(const TCHAR* Cmd, FOutputDevice& Ar)
 		Ar.Log(*Str.LeftChop(1));
 		return 1;
 	}
+	else if (ParseCommand(&Cmd, TEXT("VKCAPTURE")))
+	{
+		if (ParseCommand(&Cmd, TEXT("START")))
+		{
+			TCHAR Dir[256] = {};
+			TCHAR Fps[32] = {};
+			TCHAR Format[32] = {};
+			ParseToken(Cmd, Dir, ARRAY_COUNT(Dir), 0);
+			ParseToken(Cmd, Fps, ARRAY_COUNT(Fps), 0);
+			ParseToken(Cmd, Format, ARRAY_COUNT(Format), 0);
+
+			int fps = Clamp(appAtoi(Fps), 1, 240);
+			CaptureFormat format = CaptureFormat::PNG;
+			if (appStricmp(Format, TEXT("RAW")) == 0)
+				format = CaptureFormat::Raw;
+			else if (appStricmp(Format, TEXT("Y4M")) == 0)
+				format = CaptureFormat::Y4M;
+
+			if (!Dir[0])
+			{
+				Ar.Log(TEXT("Usage: VKCAPTURE START <dir> <fps> [PNG|RAW|Y4M]"));
+				return 1;
+			}
+
+			try
+			{
+				Capture.reset();
+				GFileManager->MakeDirectory(Dir, 1);
+				Capture.reset(new FrameCapture(this, appToAnsi(Dir), Viewport->SizeX, Viewport->SizeY, fps, format));
+				Ar.Log(FString::Printf(TEXT("Capturing %dx%d at %d fps to %s"), Capture->GetWidth(), Capture->GetHeight(), fps, Dir));
+			}
+			catch (const std::exception& e)
+			{
+				Capture.reset();
+				Ar.Log(FString::Printf(TEXT("Could not start capture: %s"), appFromAnsi(e.what())));
+			}
+			return 1;
+		}
+		else if (ParseCommand(&Cmd, TEXT("STOP")))
+		{
+			if (Capture)
+			{
+				int dropped = Capture->GetFramesDropped();
+				Capture.reset(); // Waits for the writer thread to finish the queued frames
+				Ar.Log(FString::Printf(TEXT("Capture stopped (%d frames dropped)"), dropped));
+			}
+			return 1;
+		}
+		return 0;
+	}
+	else if (ParseCommand(&Cmd, TEXT("VKMEMSTATS")))
+	{
+		if (ParseCommand(&Cmd, TEXT("SHOW")))
+		{
+			ShowMemoryStats = !ShowMemoryStats;
+			return 1;
+		}
+		else if (ParseCommand(&Cmd, TEXT("JSON")))
+		{
+			TCHAR Filename[256] = {};
+			ParseToken(Cmd, Filename, ARRAY_COUNT(Filename), 0);
+			if (!Filename[0])
+			{
+				Ar.Log(TEXT("Usage: VKMEMSTATS JSON <file>"));
+				return 1;
+			}
+
+			if (MemoryStats(this).WriteJson(appToAnsi(Filename)))
+				Ar.Log(FString::Printf(TEXT("Memory stats written to %s"), Filename));
+			else
+				Ar.Log(FString::Printf(TEXT("Could not write %s"), Filename));
+			return 1;
+		}
+
+		for (const std::string& line : MemoryStats(this).ToLines())
+			Ar.Log(appFromAnsi(line.c_str()));
+		return 1;
+	}
 #if WIN32 // To do: what does the Unix build use for the TEXT() template?
 	else if (ParseCommand(&Cmd, TEXT("GetVkDevices")))
 	{
@@ -613,44 +693,51 @@ void UVulkanRenderDevice::Lock(FPlane InFlashScale, FPlane InFlashFog, FPlane Sc
 		// If frame textures no longer match the window or user settings, recreate them along with the swap chain
 		if (!Textures->Scene || Textures->Scene->Width != Viewport->SizeX || Textures->Scene->Height != Viewport->SizeY ||Textures->Scene->Multisample != GetSettingsMultisample())
 		{
+			// Pipelines built against attachment formats only depend on the sample count
+			bool recreatePipelines = !UseDynamicRendering || !Textures->Scene || Textures->Scene->Multisample != GetSettingsMultisample();
+
 			Framebuffers->DestroySceneFramebuffer();
 			Textures->Scene.reset();
 			Textures->Scene.reset(new SceneTextures(this, Viewport->SizeX, Viewport->SizeY, GetSettingsMultisample()));
-			RenderPasses->CreateRenderPass();
-			RenderPasses->CreatePipelines();
+			if (recreatePipelines)
+			{
+				RenderPasses->CreateRenderPass();
+				RenderPasses->CreatePipelines();
+			}
 			Framebuffers->CreateSceneFramebuffer();
 			DescriptorSets->UpdateFrameDescriptors();
 		}
 
+		// Draw the world at a lower resolution while the GPU can't keep up. Everything from EndFlash onwards is drawn at full resolution.
+		SceneScaled = !HitData && UseDynamicResolution() && DynamicScale.GetScale() < 1.0f;
+		if (SceneScaled)
+		{
+			SceneScaledWidth = std::max((int)std::round(Viewport->SizeX * DynamicScale.GetScale()), 1);
+			SceneScaledHeight = std::max((int)std::round(Viewport->SizeY * DynamicScale.GetScale()), 1);
+		}
+
 		auto cmdbuffer = Commands->GetDrawCommands();
 
 		// Special thanks to Khronos and AMD for making this absolute hell to use.
 		VkAccessFlags srcColorAccess = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
 		VkAccessFlags dstColorAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
-		VkAccessFlags srcDepthAccess = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-		VkAccessFlags dstDepthAccess = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-		VkPipelineStageFlags srcStages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		VkAccessFlags srcDepthAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		VkAccessFlags dstDepthAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		VkPipelineStageFlags srcStages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
 		VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
 
-		PipelineBarrier()
-			.AddImage(Textures->Scene->ColorBuffer.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, srcColorAccess, dstColorAccess)
-			.AddImage(Textures->Scene->HitBuffer.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, srcColorAccess, dstColorAccess)
-			.AddImage(Textures->Scene->DepthBuffer.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, srcDepthAccess, dstDepthAccess, VK_IMAGE_ASPECT_DEPTH_BIT)
-			.Execute(cmdbuffer, srcStages, dstStages);
-
-		RenderPassBegin()
-			.RenderPass(RenderPasses->Scene.RenderPass.get())
-			.Framebuffer(Framebuffers->SceneFramebuffer.get())
-			.RenderArea(0, 0, Textures->Scene->Width, Textures->Scene->Height)
-			.AddClearColor(ScreenClear.X, ScreenClear.Y, ScreenClear.Z, ScreenClear.W)
-			.AddClearColor(0.0f, 0.0f, 0.0f, 0.0f)
-			.AddClearDepthStencil(1.0f, 0)
-			.Execute(cmdbuffer);
+		PipelineBarrier barrier;
+		barrier.AddImage(Textures->Scene->ColorBuffer.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, srcColorAccess, dstColorAccess);
+		barrier.AddImage(Textures->Scene->HitBuffer.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, srcColorAccess, dstColorAccess);
+		barrier.AddImage(Textures->Scene->DepthBuffer.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, srcDepthAccess, dstDepthAccess, VK_IMAGE_ASPECT_DEPTH_BIT);
+		if (UseDynamicRendering && Textures->Scene->SceneSamples != VK_SAMPLE_COUNT_1_BIT)
+		{
+			// The render pass takes care of this for its resolve attachment
+			barrier.AddImage(Textures->Scene->PPImage[0].get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, srcColorAccess, dstColorAccess);
+		}
+		barrier.Execute(cmdbuffer, srcStages, dstStages);
 
-		VkBuffer vertexBuffers[] = { Buffers->SceneVertexBuffer->buffer };
-		VkDeviceSize offsets[] = { 0 };
-		cmdbuffer->bindVertexBuffers(0, 1, vertexBuffers, offsets);
-		cmdbuffer->bindIndexBuffer(Buffers->SceneIndexBuffer->buffer, 0, VK_INDEX_TYPE_UINT32);
+		BeginScenePass(cmdbuffer, false, ScreenClear);
 
 		IsLocked = true;
 	}
@@ -669,35 +756,75 @@ void UVulkanRenderDevice::Lock(FPlane InFlashScale, FPlane InFlashFog, FPlane Sc
 void UVulkanRenderDevice::FlushDrawBatchAndWait()
 {
 	DrawBatch(Commands->GetDrawCommands());
-	Commands->GetDrawCommands()->endRenderPass();
+	EndScenePass(Commands->GetDrawCommands());
 	SubmitAndWait(false, 0, 0, false);
 
-	auto drawcommands = Commands->GetDrawCommands();
+	BeginScenePass(Commands->GetDrawCommands(), true);
+}
 
-	VkAccessFlags srcColorAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
-	VkAccessFlags dstColorAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
-	VkAccessFlags srcDepthAccess = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-	VkAccessFlags dstDepthAccess = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-	VkPipelineStageFlags srcStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-	VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+void UVulkanRenderDevice::BeginScenePass(VulkanCommandBuffer* cmdbuffer, bool continuePass, const FPlane& clearColor)
+{
+	auto buffers = Textures->Scene.get();
+	bool multisample = buffers->SceneSamples != VK_SAMPLE_COUNT_1_BIT;
 
-	PipelineBarrier()
-		.AddImage(Textures->Scene->ColorBuffer.get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, srcColorAccess, dstColorAccess)
-		.AddImage(Textures->Scene->HitBuffer.get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, srcColorAccess, dstColorAccess)
-		.AddImage(Textures->Scene->DepthBuffer.get(), VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, srcDepthAccess, dstDepthAccess, VK_IMAGE_ASPECT_DEPTH_BIT)
-		.Execute(drawcommands, srcStages, dstStages);
+	if (continuePass)
+	{
+		// The attachments stay in their layouts across the submit. All that is needed is to make the earlier writes visible again.
+		PipelineBarrier()
+			.AddMemory(
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT)
+			.Execute(cmdbuffer,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT);
+	}
 
-	RenderPassBegin()
-		.RenderPass(RenderPasses->Scene.RenderPassContinue.get())
-		.Framebuffer(Framebuffers->SceneFramebuffer.get())
-		.RenderArea(0, 0, Textures->Scene->Width, Textures->Scene->Height)
-		.Execute(drawcommands);
+	if (UseDynamicRendering)
+	{
+		// Everything is stored as a mid-frame submit can end the rendering at any time, after which the continued part loads it again
+		VkAttachmentLoadOp loadOp = continuePass ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+
+		RenderingBegin begin;
+		begin.RenderArea(0, 0, buffers->Width, buffers->Height);
+		begin.AddColorAttachment(buffers->ColorBufferView.get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, loadOp, VK_ATTACHMENT_STORE_OP_STORE, clearColor.X, clearColor.Y, clearColor.Z, clearColor.W);
+		if (multisample)
+			begin.ColorResolve(buffers->PPImageView[0].get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		begin.AddColorAttachment(buffers->HitBufferView.get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, loadOp, VK_ATTACHMENT_STORE_OP_STORE);
+		begin.DepthAttachment(buffers->DepthBufferView.get(), VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, loadOp, VK_ATTACHMENT_STORE_OP_STORE);
+		begin.Execute(cmdbuffer);
+	}
+	else
+	{
+		RenderPassBegin()
+			.RenderPass(continuePass ? RenderPasses->Scene.RenderPassContinue.get() : RenderPasses->Scene.RenderPass.get())
+			.Framebuffer(Framebuffers->SceneFramebuffer.get())
+			.RenderArea(0, 0, buffers->Width, buffers->Height)
+			.AddClearColor(clearColor.X, clearColor.Y, clearColor.Z, clearColor.W)
+			.AddClearColor(0.0f, 0.0f, 0.0f, 0.0f)
+			.AddClearDepthStencil(1.0f, 0)
+			.Execute(cmdbuffer);
+	}
+
+	VkRect2D scissor = {};
+	scissor.extent.width = buffers->Width;
+	scissor.extent.height = buffers->Height;
+	cmdbuffer->setScissor(0, 1, &scissor);
+
+	if (continuePass)
+		cmdbuffer->setViewport(0, 1, &viewportdesc);
 
 	VkBuffer vertexBuffers[] = { Buffers->SceneVertexBuffer->buffer };
 	VkDeviceSize offsets[] = { 0 };
-	drawcommands->bindVertexBuffers(0, 1, vertexBuffers, offsets);
-	drawcommands->bindIndexBuffer(Buffers->SceneIndexBuffer->buffer, 0, VK_INDEX_TYPE_UINT32);
-	drawcommands->setViewport(0, 1, &viewportdesc);
+	cmdbuffer->bindVertexBuffers(0, 1, vertexBuffers, offsets);
+	cmdbuffer->bindIndexBuffer(Buffers->SceneIndexBuffer->buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+void UVulkanRenderDevice::EndScenePass(VulkanCommandBuffer* cmdbuffer)
+{
+	if (UseDynamicRendering)
+		cmdbuffer->endRendering();
+	else
+		cmdbuffer->endRenderPass();
 }
 
 void UVulkanRenderDevice::DrawStats(FSceneNode* Frame)
@@ -706,6 +833,18 @@ void UVulkanRenderDevice::DrawStats(FSceneNode* Frame)
 
 #if defined(OLDUNREAL469SDK)
 	GRender->ShowStat(CurrentFrame, TEXT("Vulkan: Draw calls: %d, Complex surfaces: %d, Gouraud polygons: %d, Tiles: %d; Uploads: %d, Rect Uploads: %d\r\n"), Stats.DrawCalls, Stats.ComplexSurfaces, Stats.GouraudPolygons, Stats.Tiles, Stats.Uploads, Stats.RectUploads);
+
+	if (ShowMemoryStats)
+	{
+		for (const std::string& line : MemoryStats(this).ToLines())
+			GRender->ShowStat(CurrentFrame, TEXT("Vulkan: %s\r\n"), appFromAnsi(line.c_str()));
+	}
+
+	if (VkFrameRateLimit > 0)
+		GRender->ShowStat(CurrentFrame, TEXT("Vulkan: Predicted frame time: %.2f ms, Slept: %.2f ms\r\n"), Pacer.GetPredictedFrameTime(), Pacer.GetLastSleepTime());
+
+	if (UseDynamicResolution())
+		GRender->ShowStat(CurrentFrame, TEXT("Vulkan: Scene scale: %d%%, GPU time: %.2f ms\r\n"), (int)std::round(DynamicScale.GetScale() * 100.0f), DynamicScale.GetAverageGpuTime());
 #endif
 
 	Stats.DrawCalls = 0;
@@ -722,15 +861,24 @@ void UVulkanRenderDevice::Unlock(UBOOL Blit)
 
 	try
 	{
+		// Nothing called EndFlash this frame
+		if (SceneScaled)
+			UpscaleScene();
+
 		DrawBatch(Commands->GetDrawCommands());
-		Commands->GetDrawCommands()->endRenderPass();
+		EndScenePass(Commands->GetDrawCommands());
 
-		BlitSceneToPostprocess();
+		ResolveSceneForPostprocess();
 		if (Bloom)
 		{
 			RunBloomPass();
 		}
 
+		if (Capture)
+		{
+			Capture->RecordFrame(Commands->GetDrawCommands());
+		}
+
 #ifdef WIN32
 		RECT box = {};
 		GetClientRect((HWND)Viewport->GetWindow(), &box);
@@ -743,15 +891,30 @@ void UVulkanRenderDevice::Unlock(UBOOL Blit)
 		SDL_GL_GetDrawableSize(window, &windowWidth, &windowHeight);
 #endif
 
+		Uploads->StreamMips();
+
 		SubmitAndWait(Blit ? true : false, windowWidth, windowHeight, Viewport->IsFullscreen());
+		if (Blit && VkFrameRateLimit > 0)
+			Pacer.FrameFinished();
+
+		if (Capture)
+		{
+			Capture->FrameSubmitted();
+		}
+
+		if (!UseDynamicResolution())
+			DynamicScale.Reset();
+		else if (Blit)
+			DynamicScale.Update(Commands->GetLastFrameGpuTime(), 1000.0 / std::max(VkDynamicResolutionTarget, 1));
+
+		Textures->EvictTextures(VkMemoryBudget);
 
 		Batch.Pipeline = nullptr;
 
 		if (Samplers->LODBias != LODBias)
 		{
-			DescriptorSets->ClearCache();
-			Textures->ClearAllBindlessIndexes();
 			Samplers->CreateSceneSamplers();
+			DescriptorSets->UpdateSceneSamplers();
 		}
 
 		if (HitData)
@@ -795,6 +958,16 @@ void UVulkanRenderDevice::Unlock(UBOOL Blit)
 		HitData = nullptr;
 		HitSize = nullptr;
 
+		if (Blit)
+		{
+			// Hold the game back here, right before it samples input for the next frame
+			bool displayed = VkPresentWait && Commands->WaitForPresentQueue(VkMaxQueuedFrames);
+			if (VkFrameRateLimit > 0)
+				Pacer.WaitForNextFrame(1.0 / VkFrameRateLimit, displayed);
+			else
+				Pacer.Reset();
+		}
+
 		IsLocked = false;
 	}
 	catch (std::exception& e)
@@ -858,10 +1031,12 @@ void UVulkanRenderDevice::DrawComplexSurface(FSceneNode* Frame, FSurfaceInfo& Su
 	DWORD PolyFlags = ApplyPrecedenceRules(Surface.PolyFlags);
 
 	CachedTexture* tex = Textures->GetTexture(Surface.Texture, !!(PolyFlags & PF_Masked));
-	CachedTexture* lightmap = Textures->GetTexture(Surface.LightMap, false);
+	LightmapLocation lightmapLocation = Textures->GetLightmap(Surface.LightMap);
+	CachedTexture* lightmap = lightmapLocation.Texture;
 	CachedTexture* macrotex = Textures->GetTexture(Surface.MacroTexture, false);
 	CachedTexture* detailtex = Textures->GetTexture(Surface.DetailTexture, false);
-	CachedTexture* fogmap = (Surface.FogMap && Surface.FogMap->Mips[0] && Surface.FogMap->Mips[0]->DataPtr) ? Textures->GetTexture(Surface.FogMap, false) : nullptr;
+	LightmapLocation fogmapLocation = (Surface.FogMap && Surface.FogMap->Mips[0] && Surface.FogMap->Mips[0]->DataPtr) ? Textures->GetLightmap(Surface.FogMap) : LightmapLocation();
+	CachedTexture* fogmap = fogmapLocation.Texture;
 
 #if defined(UNREALGOLD)
 	if (Surface.DetailTexture && Surface.FogMap) detailtex = nullptr;
@@ -876,10 +1051,10 @@ void UVulkanRenderDevice::DrawComplexSurface(FSceneNode* Frame, FSurfaceInfo& Su
 	float VPan = tex ? VDot + Surface.Texture->Pan.Y : 0.0f;
 	float UMult = tex ? GetUMult(*Surface.Texture) : 0.0f;
 	float VMult = tex ? GetVMult(*Surface.Texture) : 0.0f;
-	float LMUPan = lightmap ? UDot + Surface.LightMap->Pan.X - 0.5f * Surface.LightMap->UScale : 0.0f;
-	float LMVPan = lightmap ? VDot + Surface.LightMap->Pan.Y - 0.5f * Surface.LightMap->VScale : 0.0f;
-	float LMUMult = lightmap ? GetUMult(*Surface.LightMap) : 0.0f;
-	float LMVMult = lightmap ? GetVMult(*Surface.LightMap) : 0.0f;
+	float LMUPan = lightmap ? UDot + Surface.LightMap->Pan.X - (0.5f + lightmapLocation.X) * Surface.LightMap->UScale : 0.0f;
+	float LMVPan = lightmap ? VDot + Surface.LightMap->Pan.Y - (0.5f + lightmapLocation.Y) * Surface.LightMap->VScale : 0.0f;
+	float LMUMult = lightmap ? GetUMult(*Surface.LightMap, lightmapLocation) : 0.0f;
+	float LMVMult = lightmap ? GetVMult(*Surface.LightMap, lightmapLocation) : 0.0f;
 	float MacroUPan = macrotex ? UDot + Surface.MacroTexture->Pan.X : 0.0f;
 	float MacroVPan = macrotex ? VDot + Surface.MacroTexture->Pan.Y : 0.0f;
 	float MacroUMult = macrotex ? GetUMult(*Surface.MacroTexture) : 0.0f;
@@ -900,10 +1075,10 @@ void UVulkanRenderDevice::DrawComplexSurface(FSceneNode* Frame, FSurfaceInfo& Su
 	if (fogmap) // if Surface.FogMap exists, use instead of detail texture
 	{
 		detailtex = fogmap;
-		DetailUPan = UDot + Surface.FogMap->Pan.X - 0.5f * Surface.FogMap->UScale;
-		DetailVPan = VDot + Surface.FogMap->Pan.Y - 0.5f * Surface.FogMap->VScale;
-		DetailUMult = GetUMult(*Surface.FogMap);
-		DetailVMult = GetVMult(*Surface.FogMap);
+		DetailUPan = UDot + Surface.FogMap->Pan.X - (0.5f + fogmapLocation.X) * Surface.FogMap->UScale;
+		DetailVPan = VDot + Surface.FogMap->Pan.Y - (0.5f + fogmapLocation.Y) * Surface.FogMap->VScale;
+		DetailUMult = GetUMult(*Surface.FogMap, fogmapLocation);
+		DetailVMult = GetVMult(*Surface.FogMap, fogmapLocation);
 	}
 
 	SetPipeline(RenderPasses->GetPipeline(PolyFlags));
@@ -1584,6 +1759,38 @@ void UVulkanRenderDevice::ReadPixels(FColor* Pixels)
 
 	DrawBatch(cmdbuffer);
 
+	int w = Viewport->SizeX;
+	int h = Viewport->SizeY;
+	void* data = Pixels;
+
+	auto dstimage = ImageBuilder()
+		.Format(VK_FORMAT_B8G8R8A8_UNORM)
+		.Usage(VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+		.Size(w, h)
+		.DebugName("ReadPixelsDstImage")
+		.Create(Device.get());
+
+	// Staging buffer for download
+	auto staging = BufferBuilder()
+		.Size(w * h * 4)
+		.Usage(VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU)
+		.DebugName("ReadPixelsStaging")
+		.Create(Device.get());
+
+	CopyPostprocessToBuffer(cmdbuffer, dstimage.get(), staging.get());
+
+	// Submit command buffers and wait for device to finish the work
+	SubmitAndWait(false, 0, 0, false);
+
+	uint8_t* pixels = (uint8_t*)staging->Map(0, w * h * 4);
+	memcpy(data, pixels, w * h * 4);
+	staging->Unmap();
+
+	unguard;
+}
+
+void UVulkanRenderDevice::CopyPostprocessToBuffer(VulkanCommandBuffer* cmdbuffer, VulkanImage* dstimage, VulkanBuffer* dstbuffer)
+{
 	if (GammaCorrectScreenshots)
 	{
 		PresentPushConstants pushconstants = GetPresentPushConstants();
@@ -1605,8 +1812,6 @@ void UVulkanRenderDevice::ReadPixels(FColor* Pixels)
 		scissor.extent.width = Textures->Scene->Width;
 		scissor.extent.height = Textures->Scene->Height;
 
-		auto cmdbuffer = Commands->GetDrawCommands();
-
 		VkAccessFlags srcColorAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
 		VkAccessFlags dstColorAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
 		VkPipelineStageFlags srcStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
@@ -1638,22 +1843,11 @@ void UVulkanRenderDevice::ReadPixels(FColor* Pixels)
 	}
 
 	// Convert from rgba16f to bgra8 using the GPU:
-	auto srcimage = Textures->Scene->PPImage[GammaCorrectScreenshots ? 1 : 0].get();
-
-	int w = Viewport->SizeX;
-	int h = Viewport->SizeY;
-	void* data = Pixels;
-
-	auto dstimage = ImageBuilder()
-		.Format(VK_FORMAT_B8G8R8A8_UNORM)
-		.Usage(VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT)
-		.Size(w, h)
-		.DebugName("ReadPixelsDstImage")
-		.Create(Device.get());
+	auto srcimage = GammaCorrectScreenshots ? Textures->Scene->PPImage[1].get() : Textures->Scene->ResolvedColorBuffer;
 
 	PipelineBarrier()
 		.AddImage(srcimage, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT)
-		.AddImage(dstimage.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT)
+		.AddImage(dstimage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT)
 		.Execute(cmdbuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
 
 	VkImageBlit blit = {};
@@ -1676,33 +1870,17 @@ void UVulkanRenderDevice::ReadPixels(FColor* Pixels)
 
 	PipelineBarrier()
 		.AddImage(srcimage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT)
-		.AddImage(dstimage.get(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT)
+		.AddImage(dstimage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT)
 		.Execute(cmdbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
 
-	// Staging buffer for download
-	auto staging = BufferBuilder()
-		.Size(w * h * 4)
-		.Usage(VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU)
-		.DebugName("ReadPixelsStaging")
-		.Create(Device.get());
-
 	// Copy from image to buffer
 	VkBufferImageCopy region = {};
-	region.imageExtent.width = w;
-	region.imageExtent.height = h;
+	region.imageExtent.width = dstimage->width;
+	region.imageExtent.height = dstimage->height;
 	region.imageExtent.depth = 1;
 	region.imageSubresource.layerCount = 1;
 	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	cmdbuffer->copyImageToBuffer(dstimage->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, staging->buffer, 1, &region);
-
-	// Submit command buffers and wait for device to finish the work
-	SubmitAndWait(false, 0, 0, false);
-
-	uint8_t* pixels = (uint8_t*)staging->Map(0, w * h * 4);
-	memcpy(data, pixels, w * h * 4);
-	staging->Unmap();
-
-	unguard;
+	cmdbuffer->copyImageToBuffer(dstimage->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstbuffer->buffer, 1, &region);
 }
 
 void UVulkanRenderDevice::EndFlash()
@@ -1746,6 +1924,11 @@ void UVulkanRenderDevice::EndFlash()
 		if (CurrentFrame)
 			SetSceneNode(CurrentFrame);
 	}
+
+	// The world is done. The HUD, console and menus that follow are drawn at full resolution.
+	if (SceneScaled)
+		UpscaleScene();
+
 	unguard;
 }
 
@@ -1769,6 +1952,16 @@ void UVulkanRenderDevice::SetSceneNode(FSceneNode* Frame)
 	viewportdesc.height = Frame->Y;
 	viewportdesc.minDepth = 0.1f;
 	viewportdesc.maxDepth = 1.0f;
+	if (SceneScaled)
+	{
+		// The scaled world goes into the top left corner of the scene buffer
+		float scaleX = SceneScaledWidth / (float)Textures->Scene->Width;
+		float scaleY = SceneScaledHeight / (float)Textures->Scene->Height;
+		viewportdesc.x *= scaleX;
+		viewportdesc.y *= scaleY;
+		viewportdesc.width *= scaleX;
+		viewportdesc.height *= scaleY;
+	}
 	commands->setViewport(0, 1, &viewportdesc);
 
 	pushconstants.objectToProjection = mat4::frustum(-RProjZ, RProjZ, -Aspect * RProjZ, Aspect * RProjZ, 1.0f, 32768.0f, handedness::left, clipzrange::zero_positive_w);
@@ -1787,51 +1980,50 @@ void UVulkanRenderDevice::PrecacheTexture(FTextureInfo& Info, DWORD PolyFlags)
 
 void UVulkanRenderDevice::ClearTextureCache()
 {
+	Uploads->ClearCache();
 	DescriptorSets->ClearCache();
 	Textures->ClearCache();
-	Uploads->ClearCache();
 }
 
-void UVulkanRenderDevice::BlitSceneToPostprocess()
+void UVulkanRenderDevice::ResolveSceneForPostprocess()
 {
 	auto buffers = Textures->Scene.get();
 	auto cmdbuffer = Commands->GetDrawCommands();
 
-	PipelineBarrier barrer0;
-	VkPipelineStageFlags srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	barrer0.AddImage(
-		buffers->ColorBuffer.get(),
+	// The scene render pass already resolved multisampled color into PPImage[0]. Without multisampling the color buffer is used as-is.
+	PipelineBarrier barrier0;
+	VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	barrier0.AddImage(
+		buffers->ResolvedColorBuffer,
 		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-		VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_ACCESS_TRANSFER_READ_BIT);
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_ACCESS_SHADER_READ_BIT);
 	if (HitData)
 	{
-		barrer0.AddImage(
+		barrier0.AddImage(
 			buffers->HitBuffer.get(),
 			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
 			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 			VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
 			VK_ACCESS_TRANSFER_READ_BIT);
-		barrer0.AddImage(
+		barrier0.AddImage(
 			buffers->PPHitBuffer.get(),
 			VK_IMAGE_LAYOUT_UNDEFINED,
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			VK_ACCESS_TRANSFER_READ_BIT,
 			VK_ACCESS_TRANSFER_WRITE_BIT);
-		srcStageMask |= VK_ACCESS_TRANSFER_WRITE_BIT;
+		dstStageMask |= VK_PIPELINE_STAGE_TRANSFER_BIT;
 	}
-	barrer0.AddImage(
-		buffers->PPImage[0].get(),
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_ACCESS_TRANSFER_WRITE_BIT);
-	barrer0.Execute(
-		Commands->GetDrawCommands(),
-		srcStageMask,
-		VK_PIPELINE_STAGE_TRANSFER_BIT);
+	barrier0.Execute(
+		cmdbuffer,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | (HitData ? VK_PIPELINE_STAGE_TRANSFER_BIT : 0),
+		dstStageMask);
 
+	if (!HitData)
+		return;
+
+	// Integer hit indexes can't be resolved by the render pass
 	if (buffers->SceneSamples != VK_SAMPLE_COUNT_1_BIT)
 	{
 		VkImageResolve resolve = {};
@@ -1839,272 +2031,172 @@ void UVulkanRenderDevice::BlitSceneToPostprocess()
 		resolve.srcSubresource.layerCount = 1;
 		resolve.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		resolve.dstSubresource.layerCount = 1;
-		resolve.extent = { (uint32_t)buffers->ColorBuffer->width, (uint32_t)buffers->ColorBuffer->height, 1 };
+		resolve.extent = { (uint32_t)buffers->HitBuffer->width, (uint32_t)buffers->HitBuffer->height, 1 };
 		cmdbuffer->resolveImage(
-			buffers->ColorBuffer->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			buffers->PPImage[0]->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			buffers->HitBuffer->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			buffers->PPHitBuffer->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			1, &resolve);
-		if (HitData)
-		{
-			cmdbuffer->resolveImage(
-				buffers->HitBuffer->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				buffers->PPHitBuffer->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				1, &resolve);
-		}
 	}
 	else
 	{
-		auto colorBuffer = buffers->ColorBuffer.get();
-		VkImageBlit blit = {};
-		blit.srcOffsets[0] = { 0, 0, 0 };
-		blit.srcOffsets[1] = { colorBuffer->width, colorBuffer->height, 1 };
-		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.srcSubresource.layerCount = 1;
-		blit.dstOffsets[0] = { 0, 0, 0 };
-		blit.dstOffsets[1] = { colorBuffer->width, colorBuffer->height, 1 };
-		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.dstSubresource.layerCount = 1;
-		cmdbuffer->blitImage(
-			colorBuffer->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			buffers->PPImage[0]->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1, &blit, VK_FILTER_NEAREST);
-		if (HitData)
-		{
-			VkImageCopy copy = {};
-			copy.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			copy.srcSubresource.layerCount = 1;
-			copy.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			copy.dstSubresource.layerCount = 1;
-			copy.extent = { (uint32_t)colorBuffer->width, (uint32_t)colorBuffer->height, (uint32_t)1 };
-			cmdbuffer->copyImage(
-				buffers->HitBuffer->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				buffers->PPHitBuffer->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				1, &copy);
-		}
+		VkImageCopy copy = {};
+		copy.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copy.srcSubresource.layerCount = 1;
+		copy.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copy.dstSubresource.layerCount = 1;
+		copy.extent = { (uint32_t)buffers->HitBuffer->width, (uint32_t)buffers->HitBuffer->height, (uint32_t)1 };
+		cmdbuffer->copyImage(
+			buffers->HitBuffer->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			buffers->PPHitBuffer->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &copy);
 	}
 
-	PipelineBarrier barrier1;
-	barrier1.AddImage(
-		buffers->PPImage[0].get(),
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_ACCESS_TRANSFER_WRITE_BIT,
-		VK_ACCESS_SHADER_READ_BIT);
-	if (HitData)
-	{
-		barrier1.AddImage(
+	PipelineBarrier()
+		.AddImage(
 			buffers->PPHitBuffer.get(),
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_TRANSFER_READ_BIT);
-	}
-	barrier1.Execute(
-		Commands->GetDrawCommands(),
-		VK_PIPELINE_STAGE_TRANSFER_BIT,
-		HitData ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+			VK_ACCESS_TRANSFER_READ_BIT)
+		.Execute(cmdbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
 
-	if (HitData)
-	{
-		VkBufferImageCopy copy = {};
-		copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		copy.imageSubresource.layerCount = 1;
-		copy.imageOffset = { (int32_t)Viewport->HitX, (int32_t)Viewport->HitY, (int32_t)0 };
-		copy.imageExtent = { (uint32_t)Viewport->HitXL, (uint32_t)Viewport->HitYL, (uint32_t)1 };
-		cmdbuffer->copyImageToBuffer(buffers->PPHitBuffer->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffers->StagingHitBuffer->buffer, 1, &copy);
+	VkBufferImageCopy copy = {};
+	copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copy.imageSubresource.layerCount = 1;
+	copy.imageOffset = { (int32_t)Viewport->HitX, (int32_t)Viewport->HitY, (int32_t)0 };
+	copy.imageExtent = { (uint32_t)Viewport->HitXL, (uint32_t)Viewport->HitYL, (uint32_t)1 };
+	cmdbuffer->copyImageToBuffer(buffers->PPHitBuffer->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffers->StagingHitBuffer->buffer, 1, &copy);
 
-		PipelineBarrier()
-			.AddBuffer(buffers->StagingHitBuffer.get(), VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT)
-			.Execute(cmdbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT);
-	}
+	PipelineBarrier()
+		.AddBuffer(buffers->StagingHitBuffer.get(), VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT)
+		.Execute(cmdbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT);
 }
 
-void UVulkanRenderDevice::RunBloomPass()
+bool UVulkanRenderDevice::UseDynamicResolution()
 {
-	float blurAmount = 0.6f + BloomAmount * (1.9f / 255.0f);
-	BloomPushConstants pushconstants;
-	ComputeBlurSamples(7, blurAmount, pushconstants.SampleWeights);
+	// Upscaling blits the color buffer, which isn't possible for a multisampled image
+	return VkDynamicResolution && !GIsEditor && Commands->HasGpuTimer() && Textures->Scene && Textures->Scene->SceneSamples == VK_SAMPLE_COUNT_1_BIT;
+}
 
+void UVulkanRenderDevice::UpscaleScene()
+{
+	auto buffers = Textures->Scene.get();
 	auto cmdbuffer = Commands->GetDrawCommands();
 
-	PipelineBarrier()
-		.AddImage(Textures->Scene->BloomBlurLevels[0].VTexture.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT)
-		.Execute(cmdbuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-
-	// Extract overbright pixels that we want to bloom:
-	BloomStep(cmdbuffer,
-		RenderPasses->Bloom.Extract.get(),
-		DescriptorSets->GetBloomPPImageSet(),
-		Framebuffers->BloomBlurLevels[0].VTextureFB.get(),
-		Textures->Scene->BloomBlurLevels[0].Width,
-		Textures->Scene->BloomBlurLevels[0].Height,
-		pushconstants);
-
-	// Blur and downscale:
-	for (int i = 0; i < NumBloomLevels - 1; i++)
-	{
-		PipelineBarrier()
-			.AddImage(Textures->Scene->BloomBlurLevels[i].HTexture.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT)
-			.AddImage(Textures->Scene->BloomBlurLevels[i].VTexture.get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_SHADER_READ_BIT)
-			.Execute(cmdbuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-
-		// Gaussian blur
-		BloomStep(cmdbuffer,
-			RenderPasses->Bloom.BlurVertical.get(),
-			DescriptorSets->GetBloomVTextureSet(i),
-			Framebuffers->BloomBlurLevels[i].HTextureFB.get(),
-			Textures->Scene->BloomBlurLevels[i].Width,
-			Textures->Scene->BloomBlurLevels[i].Height,
-			pushconstants);
-
-		PipelineBarrier()
-			.AddImage(Textures->Scene->BloomBlurLevels[i].VTexture.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT)
-			.AddImage(Textures->Scene->BloomBlurLevels[i].HTexture.get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_SHADER_READ_BIT)
-			.Execute(cmdbuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-
-		BloomStep(cmdbuffer,
-			RenderPasses->Bloom.BlurHorizontal.get(),
-			DescriptorSets->GetBloomHTextureSet(i),
-			Framebuffers->BloomBlurLevels[i].VTextureFB.get(),
-			Textures->Scene->BloomBlurLevels[i].Width,
-			Textures->Scene->BloomBlurLevels[i].Height,
-			pushconstants);
-
-		PipelineBarrier()
-			.AddImage(Textures->Scene->BloomBlurLevels[i + 1].VTexture.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT)
-			.AddImage(Textures->Scene->BloomBlurLevels[i].VTexture.get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_SHADER_READ_BIT)
-			.Execute(cmdbuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-
-		// Linear downscale
-		BloomStep(cmdbuffer,
-			RenderPasses->Bloom.Scale.get(),
-			DescriptorSets->GetBloomVTextureSet(i),
-			Framebuffers->BloomBlurLevels[i + 1].VTextureFB.get(),
-			Textures->Scene->BloomBlurLevels[i + 1].Width,
-			Textures->Scene->BloomBlurLevels[i + 1].Height,
-			pushconstants);
-	}
+	DrawBatch(cmdbuffer);
+	EndScenePass(cmdbuffer);
 
-	// Blur and upscale:
-	for (int i = NumBloomLevels - 1; i >= 0; i--)
-	{
-		PipelineBarrier()
-			.AddImage(Textures->Scene->BloomBlurLevels[i].HTexture.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT)
-			.AddImage(Textures->Scene->BloomBlurLevels[i].VTexture.get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_SHADER_READ_BIT)
-			.Execute(cmdbuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-
-		// Gaussian blur
-		BloomStep(cmdbuffer,
-			RenderPasses->Bloom.BlurVertical.get(),
-			DescriptorSets->GetBloomVTextureSet(i),
-			Framebuffers->BloomBlurLevels[i].HTextureFB.get(),
-			Textures->Scene->BloomBlurLevels[i].Width,
-			Textures->Scene->BloomBlurLevels[i].Height,
-			pushconstants);
+	// A blit can't have overlapping regions within one image. Stretch into PPImage[1] and copy the result back.
+	PipelineBarrier()
+		.AddImage(buffers->ColorBuffer.get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT)
+		.AddImage(buffers->PPImage[1].get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT)
+		.Execute(cmdbuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
 
-		PipelineBarrier()
-			.AddImage(Textures->Scene->BloomBlurLevels[i].VTexture.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT)
-			.AddImage(Textures->Scene->BloomBlurLevels[i].HTexture.get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_SHADER_READ_BIT)
-			.Execute(cmdbuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-
-		BloomStep(cmdbuffer,
-			RenderPasses->Bloom.BlurHorizontal.get(),
-			DescriptorSets->GetBloomHTextureSet(i),
-			Framebuffers->BloomBlurLevels[i].VTextureFB.get(),
-			Textures->Scene->BloomBlurLevels[i].Width,
-			Textures->Scene->BloomBlurLevels[i].Height,
-			pushconstants);
-
-		// Linear upscale
-		if (i > 0)
-		{
-			PipelineBarrier()
-				.AddImage(Textures->Scene->BloomBlurLevels[i - 1].VTexture.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT)
-				.AddImage(Textures->Scene->BloomBlurLevels[i].VTexture.get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_SHADER_READ_BIT)
-				.Execute(cmdbuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-
-			BloomStep(cmdbuffer,
-				RenderPasses->Bloom.Scale.get(),
-				DescriptorSets->GetBloomVTextureSet(i),
-				Framebuffers->BloomBlurLevels[i - 1].VTextureFB.get(),
-				Textures->Scene->BloomBlurLevels[i - 1].Width,
-				Textures->Scene->BloomBlurLevels[i - 1].Height,
-				pushconstants);
-		}
-	}
+	VkImageBlit blit = {};
+	blit.srcOffsets[1] = { SceneScaledWidth, SceneScaledHeight, 1 };
+	blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	blit.srcSubresource.layerCount = 1;
+	blit.dstOffsets[1] = { buffers->Width, buffers->Height, 1 };
+	blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	blit.dstSubresource.layerCount = 1;
+	cmdbuffer->blitImage(
+		buffers->ColorBuffer->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		buffers->PPImage[1]->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		1, &blit, VK_FILTER_LINEAR);
 
 	PipelineBarrier()
-		.AddImage(Textures->Scene->PPImage[0].get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT)
-		.AddImage(Textures->Scene->BloomBlurLevels[0].VTexture.get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_SHADER_READ_BIT)
-		.Execute(cmdbuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-
-	// Add bloom back to frame post process texture:
-	BloomStep(cmdbuffer,
-		RenderPasses->Bloom.Combine.get(),
-		DescriptorSets->GetBloomVTextureSet(0),
-		Framebuffers->PPImageFB[0].get(),
-		Textures->Scene->Width,
-		Textures->Scene->Height,
-		pushconstants);
+		.AddImage(buffers->ColorBuffer.get(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT)
+		.AddImage(buffers->PPImage[1].get(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT)
+		.Execute(cmdbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+	VkImageCopy copy = {};
+	copy.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copy.srcSubresource.layerCount = 1;
+	copy.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copy.dstSubresource.layerCount = 1;
+	copy.extent = { (uint32_t)buffers->Width, (uint32_t)buffers->Height, (uint32_t)1 };
+	cmdbuffer->copyImage(
+		buffers->PPImage[1]->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		buffers->ColorBuffer->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		1, &copy);
 
 	PipelineBarrier()
-		.AddImage(Textures->Scene->PPImage[0].get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_SHADER_READ_BIT)
-		.Execute(cmdbuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
-}
+		.AddImage(buffers->ColorBuffer.get(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT)
+		.Execute(cmdbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
 
-void UVulkanRenderDevice::BloomStep(VulkanCommandBuffer* cmdbuffer, VulkanPipeline* pipeline, VulkanDescriptorSet* input, VulkanFramebuffer* output, int width, int height, const BloomPushConstants& pushconstants)
-{
-	RenderPassBegin()
-		.RenderPass(pipeline != RenderPasses->Bloom.Combine.get() ? RenderPasses->Postprocess.RenderPass.get() : RenderPasses->Postprocess.RenderPassCombine.get())
-		.Framebuffer(output)
-		.RenderArea(0, 0, width, height)
-		.AddClearColor(0.0f, 0.0f, 0.0f, 1.0f)
-		.Execute(cmdbuffer);
+	SceneScaled = false;
+	BeginScenePass(cmdbuffer, true);
 
-	VkViewport viewport = {};
-	viewport.width = (float)width;
-	viewport.height = (float)height;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor = {};
-	scissor.extent.width = width;
-	scissor.extent.height = height;
-
-	cmdbuffer->setViewport(0, 1, &viewport);
-	cmdbuffer->setScissor(0, 1, &scissor);
-	cmdbuffer->bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-	cmdbuffer->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, RenderPasses->Bloom.PipelineLayout.get(), 0, input);
-	cmdbuffer->pushConstants(RenderPasses->Bloom.PipelineLayout.get(), VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(BloomPushConstants), &pushconstants);
-	cmdbuffer->draw(6, 1, 0, 0);
-
-	cmdbuffer->endRenderPass();
+	// The depth buffer still matches the scaled world
+	ClearZ(CurrentFrame);
+	if (CurrentFrame)
+		SetSceneNode(CurrentFrame);
 }
 
-float UVulkanRenderDevice::ComputeBlurGaussian(float n, float theta) // theta = Blur Amount
+void UVulkanRenderDevice::RunBloomPass()
 {
-	return (float)((1.0f / sqrt(2 * 3.14159265359f * theta)) * expf(-(n * n) / (2.0f * theta * theta)));
-}
+	// Dual filter bloom: downsample the overbright pixels through the pyramid, then tent upsample back up and add the result to the scene color.
+	// The old gaussian blur amount range (0.6 to 2.5) is mapped to the filter offset so that the default BloomAmount gives an offset of one texel.
+	BloomPushConstants pushconstants;
+	pushconstants.Offset = (0.6f + BloomAmount * (1.9f / 255.0f)) / 1.55f;
+	pushconstants.Intensity = 1.0f;
+	pushconstants.Padding0 = 0.0f;
+	pushconstants.Padding1 = 0.0f;
 
-void UVulkanRenderDevice::ComputeBlurSamples(int sampleCount, float blurAmount, float* sampleWeights)
-{
-	sampleWeights[0] = ComputeBlurGaussian(0, blurAmount);
+	auto cmdbuffer = Commands->GetDrawCommands();
+	auto& levels = Textures->Scene->BloomBlurLevels;
+
+	// Extract overbright pixels and downsample to the first level:
+	PipelineBarrier()
+		.AddImage(levels[0].VTexture.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_WRITE_BIT)
+		.Execute(cmdbuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 
-	float totalWeights = sampleWeights[0];
+	BloomStep(cmdbuffer, RenderPasses->Bloom.Extract.get(), DescriptorSets->GetBloomExtractSet(), levels[0].Width, levels[0].Height, pushconstants);
 
-	for (int i = 0; i < sampleCount / 2; i++)
+	// Downsample:
+	for (int i = 1; i < NumBloomLevels; i++)
 	{
-		float weight = ComputeBlurGaussian(i + 1.0f, blurAmount);
-
-		sampleWeights[i * 2 + 1] = weight;
-		sampleWeights[i * 2 + 2] = weight;
+		PipelineBarrier()
+			.AddImage(levels[i - 1].VTexture.get(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT)
+			.AddImage(levels[i].VTexture.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_WRITE_BIT)
+			.Execute(cmdbuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 
-		totalWeights += weight * 2;
+		BloomStep(cmdbuffer, RenderPasses->Bloom.Downsample.get(), DescriptorSets->GetBloomDownsampleSet(i), levels[i].Width, levels[i].Height, pushconstants);
 	}
 
-	for (int i = 0; i < sampleCount; i++)
+	// Upsample:
+	VulkanImage* upsampleInput = levels[NumBloomLevels - 1].VTexture.get();
+	for (int i = NumBloomLevels - 2; i >= 0; i--)
 	{
-		sampleWeights[i] /= totalWeights;
+		PipelineBarrier()
+			.AddImage(upsampleInput, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT)
+			.AddImage(levels[i].HTexture.get(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_WRITE_BIT)
+			.Execute(cmdbuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+		BloomStep(cmdbuffer, RenderPasses->Bloom.Upsample.get(), DescriptorSets->GetBloomUpsampleSet(i), levels[i].Width, levels[i].Height, pushconstants);
+
+		upsampleInput = levels[i].HTexture.get();
 	}
+
+	// Upsample the last level and add the bloom back to the scene color:
+	PipelineBarrier()
+		.AddImage(upsampleInput, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT)
+		.AddImage(Textures->Scene->ResolvedColorBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT)
+		.Execute(cmdbuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+	BloomStep(cmdbuffer, RenderPasses->Bloom.Combine.get(), DescriptorSets->GetBloomCombineSet(), Textures->Scene->Width, Textures->Scene->Height, pushconstants);
+
+	PipelineBarrier()
+		.AddImage(Textures->Scene->ResolvedColorBuffer, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT)
+		.Execute(cmdbuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+void UVulkanRenderDevice::BloomStep(VulkanCommandBuffer* cmdbuffer, VulkanPipeline* pipeline, VulkanDescriptorSet* input, int width, int height, const BloomPushConstants& pushconstants)
+{
+	cmdbuffer->bindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	cmdbuffer->bindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, RenderPasses->Bloom.PipelineLayout.get(), 0, input);
+	cmdbuffer->pushConstants(RenderPasses->Bloom.PipelineLayout.get(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BloomPushConstants), &pushconstants);
+	cmdbuffer->dispatch((width + 7) / 8, (height + 7) / 8, 1);
 }
 
 PresentPushConstants UVulkanRenderDevice::GetPresentPushConstants()
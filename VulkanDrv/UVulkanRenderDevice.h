@@ -9,6 +9,10 @@
 #include "ShaderManager.h"
 #include "TextureManager.h"
 #include "UploadManager.h"
+#include "FrameCapture.h"
+#include "MemoryStats.h"
+#include "DynamicResolution.h"
+#include "FramePacer.h"
 #include "vec.h"
 #include "mat.h"
 
@@ -74,6 +78,9 @@ public:
 
 	std::shared_ptr<VulkanDevice> Device;
 
+	// Scene pass uses VK_KHR_dynamic_rendering rather than VkRenderPass and VkFramebuffer objects
+	bool UseDynamicRendering = false;
+
 	std::unique_ptr<CommandBufferManager> Commands;
 
 	std::unique_ptr<SamplerManager> Samplers;
@@ -86,6 +93,14 @@ public:
 	std::unique_ptr<RenderPassManager> RenderPasses;
 	std::unique_ptr<FramebufferManager> Framebuffers;
 
+	std::unique_ptr<FrameCapture> Capture;
+
+	// Toggled by VKMEMSTATS SHOW
+	bool ShowMemoryStats = false;
+
+	DynamicResolution DynamicScale;
+	FramePacer Pacer;
+
 	// Configuration.
 	BITFIELD UseVSync;
 	FLOAT GammaOffset;
@@ -112,13 +127,23 @@ public:
 	INT VkDeviceIndex;
 	BITFIELD VkDebug;
 	BITFIELD VkExclusiveFullscreen;
+	FLOAT VkMemoryBudget;
+	BITFIELD VkPalettedTextures;
+	BITFIELD VkCompressTextures;
+	INT VkTextureCacheSize;
+	BITFIELD VkLightmapAtlas;
+	INT VkMipStreamingBudget;
+	BITFIELD VkDynamicResolution;
+	INT VkDynamicResolutionTarget;
+	BITFIELD VkPresentWait;
+	INT VkMaxQueuedFrames;
+	INT VkFrameRateLimit;
 
 	void RunBloomPass();
-	void BloomStep(VulkanCommandBuffer* cmdbuffer, VulkanPipeline* pipeline, VulkanDescriptorSet* input, VulkanFramebuffer* output, int width, int height, const BloomPushConstants &pushconstants);
-	static float ComputeBlurGaussian(float n, float theta);
-	static void ComputeBlurSamples(int sampleCount, float blurAmount, float* sampleWeights);
+	void BloomStep(VulkanCommandBuffer* cmdbuffer, VulkanPipeline* pipeline, VulkanDescriptorSet* input, int width, int height, const BloomPushConstants &pushconstants);
 
 	void DrawPresentTexture(int width, int height);
+	void CopyPostprocessToBuffer(VulkanCommandBuffer* cmdbuffer, VulkanImage* dstimage, VulkanBuffer* dstbuffer);
 	PresentPushConstants GetPresentPushConstants();
 
 	struct
@@ -144,7 +169,11 @@ public:
 
 private:
 	void ClearTextureCache();
-	void BlitSceneToPostprocess();
+	void BeginScenePass(VulkanCommandBuffer* cmdbuffer, bool continuePass, const FPlane& clearColor = FPlane(0.0f, 0.0f, 0.0f, 0.0f));
+	void EndScenePass(VulkanCommandBuffer* cmdbuffer);
+	void ResolveSceneForPostprocess();
+	bool UseDynamicResolution();
+	void UpscaleScene();
 
 	struct VertexReserveInfo
 	{
@@ -189,6 +218,11 @@ private:
 
 	bool IsLocked = false;
 
+	// The world is drawn at SceneScaledWidth x SceneScaledHeight until UpscaleScene stretches it to the full scene buffer
+	bool SceneScaled = false;
+	int SceneScaledWidth = 0;
+	int SceneScaledHeight = 0;
+
 	void SetPipeline(PipelineState* pipeline);
 	ivec4 GetTextureIndexes(DWORD PolyFlags, CachedTexture* tex, bool clamp = false);
 	ivec4 GetTextureIndexes(DWORD PolyFlags, CachedTexture* tex, CachedTexture* lightmap, CachedTexture* macrotex, CachedTexture* detailtex);
@@ -254,9 +288,13 @@ inline ivec4 UVulkanRenderDevice::GetTextureIndexes(DWORD PolyFlags, CachedTextu
 {
 	if (DescriptorSets->IsTextureArrayFull())
 	{
+		// Released slots become available once the GPU is done with them. Only start over if that wasn't enough.
 		FlushDrawBatchAndWait();
-		DescriptorSets->ClearCache();
-		Textures->ClearAllBindlessIndexes();
+		if (DescriptorSets->IsTextureArrayFull())
+		{
+			DescriptorSets->ClearCache();
+			Textures->ClearAllBindlessIndexes();
+		}
 	}
 
 	ivec4 textureBinds;
@@ -269,6 +307,8 @@ inline ivec4 UVulkanRenderDevice::GetTextureIndexes(DWORD PolyFlags, CachedTextu
 
 inline float GetUMult(const FTextureInfo& Info) { return 1.0f / (Info.UScale * Info.USize); }
 inline float GetVMult(const FTextureInfo& Info) { return 1.0f / (Info.VScale * Info.VSize); }
+inline float GetUMult(const FTextureInfo& Info, const LightmapLocation& Location) { return 1.0f / (Info.UScale * Location.TextureWidth); }
+inline float GetVMult(const FTextureInfo& Info, const LightmapLocation& Location) { return 1.0f / (Info.VScale * Location.TextureHeight); }
 
 inline DWORD ApplyPrecedenceRules(DWORD PolyFlags)
 {
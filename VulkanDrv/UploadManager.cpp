@@ -6,15 +6,57 @@
 
 UploadManager::UploadManager(UVulkanRenderDevice* renderer) : renderer(renderer)
 {
+	Workers = std::make_unique<WorkerPool>(WorkerPool::GetDefaultThreadCount());
+
+	if (renderer->VkCompressTextures && renderer->VkTextureCacheSize > 0)
+		DiskCache = std::make_unique<TextureDiskCache>("VulkanTextureCache", (int64_t)renderer->VkTextureCacheSize * 1024 * 1024);
+
+	auto supportsMipBlit = [&](VkFormat format)
+	{
+		VkFormatProperties properties = {};
+		vkGetPhysicalDeviceFormatProperties(renderer->Device->PhysicalDevice.Device, format, &properties);
+		VkFormatFeatureFlags features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+		return (properties.optimalTilingFeatures & features) == features;
+	};
+	MipBlitRGBA8 = supportsMipBlit(VK_FORMAT_R8G8B8A8_SRGB);
+	MipBlitBGRA8 = supportsMipBlit(VK_FORMAT_B8G8R8A8_SRGB);
+
+	if (renderer->Device->SupportsExtension(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME) && renderer->Device->EnabledFeatures.HostImageCopy.hostImageCopy)
+	{
+		VkPhysicalDeviceHostImageCopyPropertiesEXT hostCopyProperties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT };
+		VkPhysicalDeviceProperties2 properties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+		properties.pNext = &hostCopyProperties;
+		vkGetPhysicalDeviceProperties2(renderer->Device->PhysicalDevice.Device, &properties);
+
+		std::vector<VkImageLayout> dstLayouts(hostCopyProperties.copyDstLayoutCount);
+		hostCopyProperties.copySrcLayoutCount = 0;
+		hostCopyProperties.pCopyDstLayouts = dstLayouts.data();
+		vkGetPhysicalDeviceProperties2(renderer->Device->PhysicalDevice.Device, &properties);
+
+		// The images are copied to in the layout the shaders read them in, so that no transitions are needed afterwards
+		HostImageCopy = std::find(dstLayouts.begin(), dstLayouts.end(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) != dstLayouts.end();
+	}
 }
 
 UploadManager::~UploadManager()
 {
+	Workers->WaitAll();
 }
 
 void UploadManager::ClearCache()
 {
+	Workers->WaitAll();
+
+	// The palette atlas and the lightmap atlas pages outlive the cache clear. They must be queued again by their next upload.
+	for (CachedTexture* tex : PendingUploads)
+	{
+		tex->pendingUploads[0].clear();
+		tex->pendingUploads[1].clear();
+		tex->inPendingUploads = false;
+	}
 	PendingUploads.clear();
+	StreamingTextures.clear();
+	StreamedTextures.clear();
 }
 
 bool UploadManager::SupportsTextureFormat(ETextureFormat Format) const
@@ -27,8 +69,9 @@ void UploadManager::UploadTexture(CachedTexture* tex, const FTextureInfo& Info,
 	int width = Info.USize;
 	int height = Info.VSize;
 	int mipcount = Info.NumMips;
+	bool reupload = tex->image != nullptr;
 
-	TextureUploader* uploader = TextureUploader::GetUploader(Info.Format);
+	TextureUploader* uploader = tex->Paletted ? TextureUploader::GetPaletteIndexUploader() : TextureUploader::GetUploader(Info.Format);
 
 	if ((uint32_t)Info.USize > renderer->Device.get()->PhysicalDevice.Properties.Properties.limits.maxImageDimension2D ||
 		(uint32_t)Info.VSize > renderer->Device.get()->PhysicalDevice.Properties.Properties.limits.maxImageDimension2D ||
@@ -38,66 +81,458 @@ void UploadManager::UploadTexture(CachedTexture* tex, const FTextureInfo& Info,
 		height = 1;
 		mipcount = 1;
 		uploader = nullptr;
+		tex->Paletted = false;
 	}
 
+	// Static textures may be compressed on the worker threads. Only P8 sources are known not to need more than one bit of alpha.
+	bool compressAlpha = Info.Format != TEXF_P8;
+
+	if (!tex->image && uploader)
+	{
+		// Textures without a mip chain and realtime textures get their mips built on the GPU
+		tex->GenerateMips = Info.Texture && GetMipGenerationFormat(uploader->GetVkFormat()) != VK_FORMAT_UNDEFINED && mipcount >= 1 && (mipcount == 1 || Info.bRealtime) && (width > 1 || height > 1);
+
+		tex->Compressed = renderer->VkCompressTextures && !tex->GenerateMips && Info.Texture && !Info.bRealtime && !Info.bParametric && TextureUploader::GetCompressedUploader(uploader, compressAlpha);
+
+		// Large static textures start out with only their small mips. The bigger ones stream in over the following frames, see StreamMips.
+		tex->ResidentMip = 0;
+		if (renderer->VkMipStreamingBudget > 0 && !tex->GenerateMips && Info.Texture && !Info.bRealtime && !Info.bParametric)
+		{
+			while (tex->ResidentMip + 1 < mipcount && std::max(Info.Mips[tex->ResidentMip]->USize, Info.Mips[tex->ResidentMip]->VSize) > StreamedMipSize)
+				tex->ResidentMip++;
+		}
+
+		tex->HostCopy = HostImageCopy && !tex->GenerateMips && !tex->Compressed && tex->ResidentMip == 0 && Info.Texture && !Info.bRealtime && !Info.bParametric && SupportsHostImageCopy(uploader->GetVkFormat());
+	}
+
+	if (uploader && tex->Compressed)
+		uploader = TextureUploader::GetCompressedUploader(uploader, compressAlpha);
+
 	VkFormat format = uploader ? uploader->GetVkFormat() : VK_FORMAT_R8G8B8A8_UNORM;
 
 	if (!tex->image)
 	{
-		tex->image = ImageBuilder()
-			.Format(format)
-			.Size(width, height, mipcount)
-			.Usage(VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
-			.DebugName("CachedTexture.Image")
-			.Create(renderer->Device.get());
+		// The image is created with the sRGB alias of its format so that the blits average in linear space, while the shaders keep sampling the raw values through a UNORM view
+		VkFormat imageformat = tex->GenerateMips ? GetMipGenerationFormat(format) : format;
 
-		tex->imageView = ImageViewBuilder()
-			.Image(tex->image.get(), format)
-			.DebugName("CachedTexture.ImageView")
-			.Create(renderer->Device.get());
+		VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		if (tex->GenerateMips)
+		{
+			usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+			mipcount = 1;
+			while ((width >> mipcount) > 0 || (height >> mipcount) > 0)
+				mipcount++;
+		}
+		if (tex->HostCopy)
+			usage |= VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+
+		tex->ImageFormat = imageformat;
+		tex->ViewFormat = format;
+		tex->ImageUsage = usage;
+
+		// Lightmaps and other small textures come and go in large numbers. Their images are recycled when the texture cache is cleared.
+		// Streamed textures need a view of only their resident mips, so they always get a new image.
+		if (tex->ResidentMip > 0 || !renderer->Textures->ReuseImage(tex, imageformat, format, width, height, mipcount, usage))
+		{
+			tex->image = ImageBuilder()
+				.Format(imageformat)
+				.Flags(tex->GenerateMips ? VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT : 0)
+				.Size(width, height, mipcount)
+				.Usage(usage)
+				.DebugName("CachedTexture.Image")
+				.Create(renderer->Device.get(), &tex->AllocatedBytes);
+
+			tex->imageView = ImageViewBuilder()
+				.Image(tex->image.get(), format, VK_IMAGE_ASPECT_COLOR_BIT, tex->ResidentMip, 0, mipcount - tex->ResidentMip)
+				.DebugName("CachedTexture.ImageView")
+				.Create(renderer->Device.get());
+		}
+
+		if (tex->HostCopy)
+		{
+			VkHostImageLayoutTransitionInfoEXT transition = { VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT };
+			transition.image = tex->image->image;
+			transition.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			transition.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			transition.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			transition.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+			transition.subresourceRange.layerCount = 1;
+			vkTransitionImageLayoutEXT(renderer->Device->device, 1, &transition);
+			tex->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		}
+	}
+
+	// New static textures skip the staging buffer. Later updates use the transfer commands like everything else.
+	if (uploader && tex->HostCopy && !reupload)
+	{
+		HostCopyData(tex, Info, masked, uploader);
+		return;
+	}
+
+	// Procedural textures and lightmaps often only change in a few places. Once they are updated a second time, only the changed tiles of mip 0 are uploaded.
+	if (reupload && uploader && !tex->Compressed && (tex->GenerateMips || Info.NumMips == 1) && (Info.bRealtime || Info.bParametric || !Info.Texture))
+	{
+		if (UploadChangedTiles(tex, Info, uploader, masked))
+			return;
+	}
+
+	if (uploader && tex->ResidentMip > 0 && !reupload)
+	{
+		StartStreaming(tex, Info, masked, uploader);
+		UploadData(tex, Info, masked, uploader, tex->ResidentMip, Info.NumMips);
+		return;
+	}
+
+	// Uploading the whole chain again makes all mips resident at once
+	if (reupload && tex->ResidentMip > 0)
+	{
+		CancelStreaming(tex);
+		StreamedTextures.push_back(tex);
 	}
 
 	tex->pendingUploads[0].clear();
 	tex->pendingUploads[1].clear();
 
 	if (uploader)
-		UploadData(tex, Info, masked, uploader);
+		UploadData(tex, Info, masked, uploader, 0, tex->GenerateMips ? 1 : Info.NumMips);
 	else
 		UploadWhite(tex);
 }
 
 void UploadManager::UploadTextureRect(CachedTexture* tex, const FTextureInfo& Info, int x, int y, int w, int h)
 {
-	TextureUploader* uploader = TextureUploader::GetUploader(Info.Format);
+	TextureUploader* uploader = tex->Paletted ? TextureUploader::GetPaletteIndexUploader() : TextureUploader::GetUploader(Info.Format);
+	if (uploader && tex->Compressed)
+	{
+		uploader = TextureUploader::GetCompressedUploader(uploader, Info.Format != TEXF_P8);
+
+		// Compressed images can only be updated in whole blocks
+		w = ((x + w + 3) & ~3) - (x & ~3);
+		h = ((y + h + 3) & ~3) - (y & ~3);
+		x &= ~3;
+		y &= ~3;
+		w = std::min(w, Info.Mips[0]->USize - x);
+		h = std::min(h, Info.Mips[0]->VSize - y);
+	}
 	if (!uploader || Info.NumMips < 1 || x < 0 || y < 0 || w <= 0 || h <= 0 || x + w > Info.Mips[0]->USize || y + h > Info.Mips[0]->VSize || !Info.Mips[0]->DataPtr)
 		return;
 
+	UploadMipRect(tex, Info, uploader, false, x, y, w, h);
+
+	// The tile hashes no longer match what is in the image
+	tex->TileHashes.clear();
+}
+
+void UploadManager::UploadMipRect(CachedTexture* tex, const FTextureInfo& Info, TextureUploader* uploader, bool masked, int x, int y, int w, int h)
+{
 	size_t pixelsSize = uploader->GetUploadSize(x, y, w, h);
 	pixelsSize = (pixelsSize + 15) / 16 * 16; // memory alignment
 
-	WaitIfUploadBufferIsFull(pixelsSize);
-
-	uint8_t* data = renderer->Buffers->UploadData;
-	uint8_t* Ptr = data + UploadBufferPos;
-	uploader->UploadRect(Ptr, Info.Mips[0], x, y, w, h, Info.Palette, false);
+	UploadRange range = ReserveUpload(pixelsSize);
+	uploader->UploadRect(range.data, Info.Mips[0], x, y, w, h, Info.Palette, masked);
 
 	VkBufferImageCopy region = {};
-	region.bufferOffset = (VkDeviceSize)(Ptr - data);
+	region.bufferOffset = range.offset;
 	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	region.imageSubresource.mipLevel = 0;
 	region.imageSubresource.layerCount = 1;
 	region.imageOffset = { (int32_t)x, (int32_t)y, 0 };
 	region.imageExtent = { (uint32_t)w, (uint32_t)h, 1 };
 
-	AddPendingUpload(tex, region, true);
+	AddPendingUpload(tex, range.buffer, region, true);
+}
+
+void UploadManager::UploadPalette(CachedTexture* atlas, int row, const FColor* palette)
+{
+	int pixelsSize = 256 * sizeof(FColor);
+
+	UploadRange range = ReserveUpload(pixelsSize);
+	memcpy(range.data, palette, pixelsSize);
 
-	UploadBufferPos += pixelsSize;
+	VkBufferImageCopy region = {};
+	region.bufferOffset = range.offset;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, (int32_t)row, 0 };
+	region.imageExtent = { 256, 1, 1 };
+	AddPendingUpload(atlas, range.buffer, region, true);
 }
 
-void UploadManager::UploadData(CachedTexture* tex, const FTextureInfo& Info, bool masked, TextureUploader* uploader)
+void UploadManager::HostCopyData(CachedTexture* tex, const FTextureInfo& Info, bool masked, TextureUploader* uploader)
 {
-	size_t pixelsSize = 0;
+	struct HostCopyMip
+	{
+		FMipmapBase Mip;
+		int Level;
+	};
+
+	std::vector<HostCopyMip> mips;
 	for (INT level = 0; level < Info.NumMips; level++)
+	{
+		if (Info.Mips[level]->DataPtr)
+			mips.push_back({ *Info.Mips[level], level });
+	}
+	if (mips.empty())
+		return;
+
+	for (HostCopyMip& mip : mips)
+		FrameUploadBytes += uploader->GetUploadSize(0, 0, mip.Mip.USize, mip.Mip.VSize);
+
+	std::shared_ptr<FColor> palette;
+	if (Info.Palette)
+	{
+		palette.reset(new FColor[256], std::default_delete<FColor[]>());
+		memcpy(palette.get(), Info.Palette, 256 * sizeof(FColor));
+	}
+
+	// The texture is unlocked once this returns and the engine may unload its mips before the job runs. The job reads a copy of the mip data instead.
+	size_t sourceSize = 0;
+	for (HostCopyMip& mip : mips)
+		sourceSize += uploader->GetSourceSize(mip.Mip.USize, mip.Mip.VSize);
+
+	std::shared_ptr<std::vector<BYTE>> source = std::make_shared<std::vector<BYTE>>(sourceSize);
+	BYTE* sourcePos = source->data();
+	for (HostCopyMip& mip : mips)
+	{
+		size_t size = uploader->GetSourceSize(mip.Mip.USize, mip.Mip.VSize);
+		memcpy(sourcePos, mip.Mip.DataPtr, size);
+		mip.Mip.DataPtr = sourcePos;
+		sourcePos += size;
+	}
+
+	// Direct formats are copied straight from the mip data. Everything else is converted into a temporary buffer first.
+	bool direct = uploader->IsDirectCopy();
+	VkDevice device = renderer->Device->device;
+	VkImage image = tex->image->image;
+
+	// All mips go in one job as host access to an image must be externally synchronized
+	Workers->Run([=]() mutable {
+		std::vector<size_t> offsets;
+		std::vector<uint8_t> pixels;
+		if (!direct)
+		{
+			size_t pixelsSize = 0;
+			for (HostCopyMip& mip : mips)
+			{
+				offsets.push_back(pixelsSize);
+				pixelsSize += uploader->GetUploadSize(0, 0, mip.Mip.USize, mip.Mip.VSize);
+			}
+			pixels.resize(pixelsSize);
+		}
+
+		std::vector<VkMemoryToImageCopyEXT> regions;
+		for (size_t i = 0; i < mips.size(); i++)
+		{
+			HostCopyMip& mip = mips[i];
+
+			VkMemoryToImageCopyEXT region = { VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT };
+			if (direct)
+			{
+				region.pHostPointer = mip.Mip.DataPtr;
+			}
+			else
+			{
+				uploader->UploadRect(pixels.data() + offsets[i], &mip.Mip, 0, 0, mip.Mip.USize, mip.Mip.VSize, palette.get(), masked);
+				region.pHostPointer = pixels.data() + offsets[i];
+			}
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = mip.Level;
+			region.imageSubresource.layerCount = 1;
+			region.imageExtent = { (uint32_t)mip.Mip.USize, (uint32_t)mip.Mip.VSize, 1 };
+			regions.push_back(region);
+		}
+
+		VkCopyMemoryToImageInfoEXT copyInfo = { VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT };
+		copyInfo.dstImage = image;
+		copyInfo.dstImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		copyInfo.regionCount = (uint32_t)regions.size();
+		copyInfo.pRegions = regions.data();
+		vkCopyMemoryToImageEXT(device, &copyInfo);
+		source.reset();
+	});
+}
+
+bool UploadManager::SupportsHostImageCopy(VkFormat format)
+{
+	auto it = HostImageCopyFormats.find(format);
+	if (it != HostImageCopyFormats.end())
+		return it->second;
+
+	VkFormatProperties3 properties3 = { VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3 };
+	VkFormatProperties2 properties = { VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2 };
+	properties.pNext = &properties3;
+	vkGetPhysicalDeviceFormatProperties2(renderer->Device->PhysicalDevice.Device, format, &properties);
+
+	bool supported = (properties3.optimalTilingFeatures & VK_FORMAT_FEATURE_2_HOST_IMAGE_TRANSFER_BIT_EXT) != 0;
+	if (supported)
+	{
+		// Some devices store host copied images in a layout that is slower for the GPU to sample. The staging path is the better choice there.
+		VkPhysicalDeviceImageFormatInfo2 formatInfo = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2 };
+		formatInfo.format = format;
+		formatInfo.type = VK_IMAGE_TYPE_2D;
+		formatInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		formatInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+
+		VkHostImageCopyDevicePerformanceQueryEXT performance = { VK_STRUCTURE_TYPE_HOST_IMAGE_COPY_DEVICE_PERFORMANCE_QUERY_EXT };
+		VkImageFormatProperties2 imageProperties = { VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2 };
+		imageProperties.pNext = &performance;
+		supported = vkGetPhysicalDeviceImageFormatProperties2(renderer->Device->PhysicalDevice.Device, &formatInfo, &imageProperties) == VK_SUCCESS && performance.optimalDeviceAccess;
+	}
+	HostImageCopyFormats[format] = supported;
+	return supported;
+}
+
+bool UploadManager::UploadChangedTiles(CachedTexture* tex, const FTextureInfo& Info, TextureUploader* uploader, bool masked)
+{
+	FMipmapBase* Mip = Info.Mips[0];
+	int bytesPerPixel = GetSourceBytesPerPixel(Info.Format);
+	if (bytesPerPixel == 0 || !Mip->DataPtr || Mip->USize != tex->image->width || Mip->VSize != tex->image->height)
+		return false;
+
+	int width = Mip->USize;
+	int height = Mip->VSize;
+	int tilesX = (width + DirtyTileSize - 1) / DirtyTileSize;
+	int tilesY = (height + DirtyTileSize - 1) / DirtyTileSize;
+
+	// A palette baked into the converted pixels changes every tile
+	uint64_t seed = masked ? 1 : 0;
+	if (Info.Format == TEXF_P8 && !tex->Paletted && Info.Palette)
+		seed = TextureDiskCache::Hash(Info.Palette, 256 * sizeof(FColor), seed);
+
+	std::vector<uint64_t> hashes(tilesX * tilesY);
+	size_t pitch = (size_t)width * bytesPerPixel;
+	for (int tileY = 0; tileY < tilesY; tileY++)
+	{
+		int y0 = tileY * DirtyTileSize;
+		int y1 = std::min(y0 + (int)DirtyTileSize, height);
+		for (int tileX = 0; tileX < tilesX; tileX++)
+		{
+			int x0 = tileX * DirtyTileSize;
+			int x1 = std::min(x0 + (int)DirtyTileSize, width);
+			uint64_t hash = seed;
+			for (int y = y0; y < y1; y++)
+				hash = TextureDiskCache::Hash(Mip->DataPtr + y * pitch + x0 * bytesPerPixel, (x1 - x0) * bytesPerPixel, hash);
+			hashes[tileX + tileY * tilesX] = hash;
+		}
+	}
+
+	bool compare = tex->TileHashes.size() == hashes.size();
+	std::vector<uint64_t> oldHashes;
+	oldHashes.swap(tex->TileHashes);
+	tex->TileHashes.swap(hashes);
+
+	if (!compare)
+		return false;
+
+	int changedTiles = 0;
+	for (size_t i = 0; i < oldHashes.size(); i++)
+	{
+		if (oldHashes[i] != tex->TileHashes[i])
+			changedTiles++;
+	}
+
+	if (changedTiles == 0)
+		return true;
+
+	// Many small regions cost more than one full upload
+	if (changedTiles * 2 > tilesX * tilesY)
+		return false;
+
+	// Neighbouring changed tiles on the same row are uploaded as one region. The regions share the upload buffer and are copied by a single command.
+	for (int tileY = 0; tileY < tilesY; tileY++)
+	{
+		int tileX = 0;
+		while (tileX < tilesX)
+		{
+			int index = tileX + tileY * tilesX;
+			if (oldHashes[index] == tex->TileHashes[index])
+			{
+				tileX++;
+				continue;
+			}
+
+			int start = tileX;
+			while (tileX < tilesX && oldHashes[tileX + tileY * tilesX] != tex->TileHashes[tileX + tileY * tilesX])
+				tileX++;
+
+			int x = start * DirtyTileSize;
+			int y = tileY * DirtyTileSize;
+			int w = std::min(tileX * (int)DirtyTileSize, width) - x;
+			int h = std::min(y + (int)DirtyTileSize, height) - y;
+			UploadMipRect(tex, Info, uploader, masked, x, y, w, h);
+		}
+	}
+	return true;
+}
+
+int UploadManager::GetSourceBytesPerPixel(ETextureFormat format)
+{
+	switch (format)
+	{
+	case TEXF_P8: return 1;
+	case TEXF_RGB8: return 3;
+#if !defined(OLDUNREAL469SDK)
+	case TEXF_RGBA7: return 4;
+	case TEXF_RGB16: return 2;
+	case TEXF_RGBA8: return 4;
+#else
+	case TEXF_BGRA8_LM: return 4;
+	case TEXF_R5G6B5: return 2;
+	case TEXF_BGRA8: return 4;
+#endif
+	default: return 0; // Block compressed or wider formats are always uploaded whole
+	}
+}
+
+bool UploadManager::SupportsAtlasUpload(const FTextureInfo& Info) const
+{
+	TextureUploader* uploader = TextureUploader::GetUploader(Info.Format);
+	return uploader && uploader->GetVkFormat() == VK_FORMAT_R8G8B8A8_UNORM && Info.NumMips > 0 && Info.Mips[0]->DataPtr;
+}
+
+void UploadManager::UploadAtlasRect(CachedTexture* atlas, const FTextureInfo& Info, int w, int h, int x, int y, int gutter)
+{
+	TextureUploader* uploader = TextureUploader::GetUploader(Info.Format);
+	if (!uploader || uploader->GetVkFormat() != VK_FORMAT_R8G8B8A8_UNORM || Info.NumMips < 1 || !Info.Mips[0]->DataPtr)
+		return;
+
+	w = std::min(w, (int)Info.Mips[0]->USize);
+	h = std::min(h, (int)Info.Mips[0]->VSize);
+	if (w <= 0 || h <= 0)
+		return;
+
+	AtlasPixels.resize((size_t)w * h);
+	uploader->UploadRect(AtlasPixels.data(), Info.Mips[0], 0, 0, w, h, Info.Palette, false);
+
+	// Replicating the edges keeps bilinear filtering from picking up texels of the neighbouring maps
+	int gw = w + gutter * 2;
+	int gh = h + gutter * 2;
+	size_t pixelsSize = (size_t)gw * gh * 4;
+	pixelsSize = (pixelsSize + 15) / 16 * 16; // memory alignment
+
+	UploadRange range = ReserveUpload(pixelsSize);
+	uint32_t* dest = (uint32_t*)range.data;
+	for (int gy = 0; gy < gh; gy++)
+	{
+		const uint32_t* src = AtlasPixels.data() + (size_t)std::max(std::min(gy - gutter, h - 1), 0) * w;
+		for (int gx = 0; gx < gw; gx++)
+			*(dest++) = src[std::max(std::min(gx - gutter, w - 1), 0)];
+	}
+
+	VkBufferImageCopy region = {};
+	region.bufferOffset = range.offset;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { (int32_t)(x - gutter), (int32_t)(y - gutter), 0 };
+	region.imageExtent = { (uint32_t)gw, (uint32_t)gh, 1 };
+	AddPendingUpload(atlas, range.buffer, region, true);
+}
+
+void UploadManager::UploadData(CachedTexture* tex, const FTextureInfo& Info, bool masked, TextureUploader* uploader, int firstmip, int mipcount)
+{
+	size_t pixelsSize = 0;
+	for (INT level = firstmip; level < mipcount; level++)
 	{
 		FMipmapBase* Mip = Info.Mips[level];
 		if (Mip->DataPtr)
@@ -108,9 +543,31 @@ void UploadManager::UploadData(CachedTexture* tex, const FTextureInfo& Info, boo
 		}
 	}
 
-	WaitIfUploadBufferIsFull(pixelsSize);
+	UploadRange range = ReserveUpload(pixelsSize);
+	size_t rangePos = 0;
 
-	for (INT level = 0; level < Info.NumMips; level++)
+	// Lightmaps, fogmaps and realtime textures live in memory the engine reuses before the uploads are submitted. They must be converted right away.
+	bool async = Info.Texture && !Info.bRealtime && !Info.bParametric;
+
+	struct MipJob
+	{
+		FMipmapBase Mip;
+		uint8_t* Dest;
+	};
+	std::vector<MipJob> largeMips;
+	std::vector<MipJob> smallMips;
+
+	// Compressed textures found in the disk cache skip the conversion. The whole chain must then be handled by one job, as the cache key covers all mips.
+	bool cached = async && tex->Compressed && DiskCache;
+
+	std::shared_ptr<FColor> palette;
+	if (async && Info.Palette)
+	{
+		palette.reset(new FColor[256], std::default_delete<FColor[]>());
+		memcpy(palette.get(), Info.Palette, 256 * sizeof(FColor));
+	}
+
+	for (INT level = firstmip; level < mipcount; level++)
 	{
 		FMipmapBase* Mip = Info.Mips[level];
 		if (Mip->DataPtr)
@@ -119,49 +576,367 @@ void UploadManager::UploadData(CachedTexture* tex, const FTextureInfo& Info, boo
 			uint32_t mipheight = Mip->VSize;
 
 			VkBufferImageCopy region = {};
-			region.bufferOffset = UploadBufferPos;
+			region.bufferOffset = range.offset + rangePos;
 			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			region.imageSubresource.mipLevel = level;
 			region.imageSubresource.layerCount = 1;
 			region.imageOffset = { 0, 0, 0 };
 			region.imageExtent = { mipwidth, mipheight, 1 };
-			AddPendingUpload(tex, region, false);
+			AddPendingUpload(tex, range.buffer, region, false);
 
-			uploader->UploadRect(renderer->Buffers->UploadData + UploadBufferPos, Mip, 0, 0, Mip->USize, Mip->VSize, Info.Palette, masked);
+			uint8_t* dest = range.data + rangePos;
 
 			INT mipsize = uploader->GetUploadSize(0, 0, Mip->USize, Mip->VSize);
+			if (!async)
+			{
+				uploader->UploadRect(dest, Mip, 0, 0, Mip->USize, Mip->VSize, Info.Palette, masked);
+			}
+			else if (mipsize >= MinMipJobSize && !cached)
+			{
+				largeMips.push_back({ *Mip, dest });
+			}
+			else
+			{
+				smallMips.push_back({ *Mip, dest });
+			}
+
 			mipsize = (mipsize + 15) / 16 * 16; // memory alignment
-			UploadBufferPos += mipsize;
+			rangePos += mipsize;
 		}
 	}
+
+	if (largeMips.empty() && smallMips.empty())
+		return;
+
+	// The texture is unlocked once this returns and the engine may unload its mips before the jobs run. They convert a copy of the mip data instead.
+	size_t sourceSize = 0;
+	for (const std::vector<MipJob>* jobs : { &largeMips, &smallMips })
+	{
+		for (const MipJob& job : *jobs)
+			sourceSize += uploader->GetSourceSize(job.Mip.USize, job.Mip.VSize);
+	}
+
+	std::shared_ptr<std::vector<BYTE>> source = std::make_shared<std::vector<BYTE>>(sourceSize);
+	BYTE* sourcePos = source->data();
+	for (std::vector<MipJob>* jobs : { &largeMips, &smallMips })
+	{
+		for (MipJob& job : *jobs)
+		{
+			size_t size = uploader->GetSourceSize(job.Mip.USize, job.Mip.VSize);
+			memcpy(sourcePos, job.Mip.DataPtr, size);
+			job.Mip.DataPtr = sourcePos;
+			sourcePos += size;
+		}
+	}
+
+	for (MipJob& job : largeMips)
+	{
+		Workers->Run([=]() mutable {
+			uploader->UploadRect(job.Dest, &job.Mip, 0, 0, job.Mip.USize, job.Mip.VSize, palette.get(), masked);
+			source.reset();
+		});
+	}
+
+	if (cached && !smallMips.empty())
+	{
+		uint8_t* chainStart = range.data;
+		size_t chainSize = pixelsSize;
+		uint64_t seed = ((uint64_t)Info.Format << 32) | ((uint64_t)uploader->GetVkFormat() << 1) | (masked ? 1 : 0);
+		TextureDiskCache::EntryDesc desc(Info.Format, uploader->GetVkFormat(), masked);
+		for (MipJob& job : smallMips)
+			desc.AddMip(job.Mip.USize, job.Mip.VSize);
+		TextureDiskCache* diskCache = DiskCache.get();
+
+		Workers->Run([=]() mutable {
+			uint64_t key = seed;
+			for (MipJob& job : smallMips)
+				key = TextureDiskCache::Hash(job.Mip.DataPtr, uploader->GetSourceSize(job.Mip.USize, job.Mip.VSize), key);
+			if (palette)
+				key = TextureDiskCache::Hash(palette.get(), 256 * sizeof(FColor), key);
+
+			if (diskCache->Load(key, desc, chainStart, chainSize))
+				return;
+
+			for (MipJob& job : smallMips)
+				uploader->UploadRect(job.Dest, &job.Mip, 0, 0, job.Mip.USize, job.Mip.VSize, palette.get(), masked);
+			diskCache->Store(key, desc, chainStart, chainSize);
+			source.reset();
+		});
+	}
+	else if (!smallMips.empty())
+	{
+		Workers->Run([=]() mutable {
+			for (MipJob& job : smallMips)
+				uploader->UploadRect(job.Dest, &job.Mip, 0, 0, job.Mip.USize, job.Mip.VSize, palette.get(), masked);
+			source.reset();
+		});
+	}
 }
 
 void UploadManager::UploadWhite(CachedTexture* tex)
 {
-	WaitIfUploadBufferIsFull(16);
-
-	auto data = (uint32_t*)(renderer->Buffers->UploadData + UploadBufferPos);
+	UploadRange range = ReserveUpload(16);
+	auto data = (uint32_t*)range.data;
 	data[0] = 0xffffffff;
 
 	VkBufferImageCopy region = {};
-	region.bufferOffset = UploadBufferPos;
+	region.bufferOffset = range.offset;
 	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	region.imageSubresource.layerCount = 1;
 	region.imageExtent = { 1, 1, 1 };
-	AddPendingUpload(tex, region, false);
+	AddPendingUpload(tex, range.buffer, region, false);
+}
+
+UploadManager::UploadRange UploadManager::ReserveUpload(size_t bytes)
+{
+	bytes = (bytes + 15) / 16 * 16;
+	FrameUploadBytes += bytes;
+
+	// Large uploads get their own staging buffer rather than waiting for a big part of the ring to retire
+	if (bytes > (size_t)DedicatedUploadSize)
+	{
+		auto buffer = BufferBuilder()
+			.Usage(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY)
+			.Size(bytes)
+			.DebugName("DedicatedUploadBuffer")
+			.Create(renderer->Device.get());
+
+		UploadRange range;
+		range.buffer = buffer->buffer;
+		range.data = (uint8_t*)buffer->Map(0, bytes);
+		range.offset = 0;
+		DedicatedUploadBuffers.push_back(std::move(buffer));
+		return range;
+	}
+
+	// Cut the uploads into small batches, so that reusing a part of the ring only has to wait for the oldest batch covering it
+	if (UploadBufferPos - PendingRangeStart >= (size_t)UploadBatchSize)
+		SubmitUploadBatch();
+
+	if (UploadBufferPos + bytes > (size_t)BufferManager::UploadBufferSize)
+	{
+		// Wrap around. The uploads at the end of the buffer must be submitted first, as the pending range can't be split in two.
+		SubmitUploadBatch();
+		UploadBufferPos = 0;
+		PendingRangeStart = 0;
+	}
+
+	WaitForUploadRange(UploadBufferPos, UploadBufferPos + bytes);
 
-	UploadBufferPos += 16; // 16-byte aligned
+	UploadRange range;
+	range.buffer = renderer->Buffers->UploadBuffer->buffer;
+	range.data = renderer->Buffers->UploadData + UploadBufferPos;
+	range.offset = UploadBufferPos;
+	UploadBufferPos += bytes;
+
+	// Everything from the oldest batch still in flight up to here is in use
+	size_t oldest = InFlightUploads.empty() ? PendingRangeStart : InFlightUploads.front().Start;
+	size_t used = (oldest <= UploadBufferPos) ? UploadBufferPos - oldest : BufferManager::UploadBufferSize - oldest + UploadBufferPos;
+	UploadBufferHighWater = std::max(UploadBufferHighWater, used);
+	return range;
 }
 
-void UploadManager::WaitIfUploadBufferIsFull(int bytes)
+void UploadManager::SubmitUploadBatch()
 {
-	if (UploadBufferPos + bytes > BufferManager::UploadBufferSize)
+	SubmitUploads();
+
+	std::unique_ptr<VulkanFence> fence;
+	if (!FreeFences.empty())
+	{
+		fence = std::move(FreeFences.back());
+		FreeFences.pop_back();
+	}
+	else
 	{
-		renderer->Commands->WaitForTransfer();
+		fence = FenceBuilder()
+			.DebugName("UploadFence")
+			.Create(renderer->Device.get());
+	}
+
+	if (renderer->Commands->SubmitTransfer(fence.get()))
+	{
+		InFlightUploadBatch batch;
+		batch.Start = PendingRangeStart;
+		batch.End = UploadBufferPos;
+		batch.Fence = std::move(fence);
+		InFlightUploads.push_back(std::move(batch));
+	}
+	else
+	{
+		FreeFences.push_back(std::move(fence));
+	}
+	PendingRangeStart = UploadBufferPos;
+}
+
+void UploadManager::WaitForUploadRange(size_t start, size_t end)
+{
+	// Batches retire in submission order, so wait for the oldest ones until none of them overlap the range
+	while (true)
+	{
+		bool overlaps = false;
+		for (const InFlightUploadBatch& batch : InFlightUploads)
+		{
+			if (batch.Start < end && start < batch.End)
+			{
+				overlaps = true;
+				break;
+			}
+		}
+		if (!overlaps)
+			break;
+
+		VulkanFence* fence = InFlightUploads.front().Fence.get();
+		vkWaitForFences(renderer->Device.get()->device, 1, &fence->fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		vkResetFences(renderer->Device.get()->device, 1, &fence->fence);
+		FreeFences.push_back(std::move(InFlightUploads.front().Fence));
+		InFlightUploads.pop_front();
 	}
 }
 
-void UploadManager::AddPendingUpload(CachedTexture* tex, const VkBufferImageCopy& region, bool isPartial)
+void UploadManager::UploadsFinished(bool present)
+{
+	// The whole queue is idle and all batches have retired. The ring keeps its position, so the next frames continue where this one stopped.
+	for (InFlightUploadBatch& batch : InFlightUploads)
+	{
+		vkResetFences(renderer->Device.get()->device, 1, &batch.Fence->fence);
+		FreeFences.push_back(std::move(batch.Fence));
+	}
+	InFlightUploads.clear();
+	PendingRangeStart = UploadBufferPos;
+
+	// A frame split by mid-frame submits is counted in parts
+	if (present)
+	{
+		LastFrameUploadBytes = FrameUploadBytes;
+		FrameUploadBytes = 0;
+	}
+
+	// The last mips of these textures have landed. Their views can now cover the whole chain.
+	for (CachedTexture* tex : StreamedTextures)
+	{
+		renderer->Commands->FrameDeleteList->imageViews.push_back(std::move(tex->imageView));
+		tex->imageView = ImageViewBuilder()
+			.Image(tex->image.get(), tex->ViewFormat)
+			.DebugName("CachedTexture.ImageView")
+			.Create(renderer->Device.get());
+		tex->ResidentMip = 0;
+
+		// The bindless slot still refers to the old view. The texture gets a new slot the next time it is used.
+		renderer->DescriptorSets->ReleaseTextureArrayIndex(tex);
+	}
+	StreamedTextures.clear();
+}
+
+void UploadManager::StartStreaming(CachedTexture* tex, const FTextureInfo& Info, bool masked, TextureUploader* uploader)
+{
+	StreamingTexture streaming;
+	streaming.Texture = tex;
+	streaming.Uploader = uploader;
+	streaming.Format = Info.Format;
+	streaming.Masked = masked;
+	streaming.NextLevel = tex->ResidentMip;
+
+	// The engine may unload the mips of the texture as soon as it is unlocked, long before the last of them is streamed in.
+	// The levels that aren't resident yet are streamed from a copy of their data instead.
+	for (int level = 0; level < tex->ResidentMip; level++)
+	{
+		FMipmapBase mip = *Info.Mips[level];
+		std::shared_ptr<std::vector<BYTE>> source;
+		if (mip.DataPtr)
+		{
+			source = std::make_shared<std::vector<BYTE>>(mip.DataPtr, mip.DataPtr + uploader->GetSourceSize(mip.USize, mip.VSize));
+			mip.DataPtr = source->data();
+		}
+		streaming.Mips.push_back(mip);
+		streaming.Sources.push_back(std::move(source));
+	}
+	if (Info.Palette)
+	{
+		streaming.Palette.reset(new FColor[256], std::default_delete<FColor[]>());
+		memcpy(streaming.Palette.get(), Info.Palette, 256 * sizeof(FColor));
+	}
+	StreamingTextures.push_back(std::move(streaming));
+}
+
+void UploadManager::CancelStreaming(CachedTexture* tex)
+{
+	if (tex->ResidentMip == 0)
+		return;
+
+	StreamingTextures.erase(std::remove_if(StreamingTextures.begin(), StreamingTextures.end(), [=](const StreamingTexture& s) { return s.Texture == tex; }), StreamingTextures.end());
+	StreamedTextures.erase(std::remove(StreamedTextures.begin(), StreamedTextures.end(), tex), StreamedTextures.end());
+}
+
+void UploadManager::StreamMips()
+{
+	// At least one mip is uploaded every frame, even if it is larger than the budget
+	size_t budget = (size_t)renderer->VkMipStreamingBudget * 1024 * 1024;
+	size_t streamed = 0;
+	while (!StreamingTextures.empty() && streamed < budget)
+	{
+		StreamingTexture& streaming = StreamingTextures.front();
+		streaming.NextLevel--;
+		streamed += StreamMip(streaming, streaming.NextLevel);
+
+		if (streaming.NextLevel == 0)
+		{
+			StreamedTextures.push_back(streaming.Texture);
+			StreamingTextures.pop_front();
+		}
+	}
+}
+
+size_t UploadManager::StreamMip(StreamingTexture& streaming, int level)
+{
+	FMipmapBase mip = streaming.Mips[level];
+	if (!mip.DataPtr)
+		return 0;
+
+	size_t mipsize = streaming.Uploader->GetUploadSize(0, 0, mip.USize, mip.VSize);
+	UploadRange range = ReserveUpload(mipsize);
+
+	VkBufferImageCopy region = {};
+	region.bufferOffset = range.offset;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = level;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = { (uint32_t)mip.USize, (uint32_t)mip.VSize, 1 };
+	AddPendingUpload(streaming.Texture, range.buffer, region, false);
+
+	TextureUploader* uploader = streaming.Uploader;
+	std::shared_ptr<std::vector<BYTE>> source = std::move(streaming.Sources[level]);
+	std::shared_ptr<FColor> palette = streaming.Palette;
+	bool masked = streaming.Masked;
+	uint8_t* dest = range.data;
+
+	// Compressed mips are cached one by one, as their chain is uploaded in pieces
+	TextureDiskCache* diskCache = streaming.Texture->Compressed ? DiskCache.get() : nullptr;
+	uint64_t seed = ((uint64_t)streaming.Format << 32) | ((uint64_t)uploader->GetVkFormat() << 1) | (masked ? 1 : 0);
+	TextureDiskCache::EntryDesc desc(streaming.Format, uploader->GetVkFormat(), masked);
+	desc.AddMip(mip.USize, mip.VSize);
+
+	Workers->Run([=]() mutable {
+		uint64_t key = 0;
+		if (diskCache)
+		{
+			key = TextureDiskCache::Hash(mip.DataPtr, uploader->GetSourceSize(mip.USize, mip.VSize), seed);
+			if (palette)
+				key = TextureDiskCache::Hash(palette.get(), 256 * sizeof(FColor), key);
+			if (diskCache->Load(key, desc, dest, mipsize))
+				return;
+		}
+
+		uploader->UploadRect(dest, &mip, 0, 0, mip.USize, mip.VSize, palette.get(), masked);
+
+		if (diskCache)
+			diskCache->Store(key, desc, dest, mipsize);
+		source.reset();
+	});
+
+	return mipsize;
+}
+
+void UploadManager::AddPendingUpload(CachedTexture* tex, VkBuffer buffer, const VkBufferImageCopy& region, bool isPartial)
 {
 	if (!tex->inPendingUploads)
 	{
@@ -169,11 +944,81 @@ void UploadManager::AddPendingUpload(CachedTexture* tex, const VkBufferImageCopy
 		tex->inPendingUploads = true;
 	}
 
-	tex->pendingUploads[isPartial].push_back(region);
+	PendingTextureUpload upload;
+	upload.buffer = buffer;
+	upload.region = region;
+	tex->pendingUploads[isPartial].push_back(upload);
+}
+
+VkFormat UploadManager::GetMipGenerationFormat(VkFormat format) const
+{
+	if (format == VK_FORMAT_R8G8B8A8_UNORM && MipBlitRGBA8)
+		return VK_FORMAT_R8G8B8A8_SRGB;
+	else if (format == VK_FORMAT_B8G8R8A8_UNORM && MipBlitBGRA8)
+		return VK_FORMAT_B8G8R8A8_SRGB;
+	else
+		return VK_FORMAT_UNDEFINED;
+}
+
+void UploadManager::GenerateMipmaps(VulkanCommandBuffer* cmdbuffer)
+{
+	// All levels are in transfer dst layout at this point. Each level is moved to transfer src once written and used as the source for the next one.
+	// The textures are processed level by level so that one barrier covers all of them.
+	int maxLevels = 0;
+	for (CachedTexture* tex : PendingUploads)
+	{
+		if (tex->GenerateMips)
+			maxLevels = std::max(maxLevels, tex->image->mipLevels);
+	}
+
+	for (int level = 1; level <= maxLevels; level++)
+	{
+		PipelineBarrier barrier;
+		for (CachedTexture* tex : PendingUploads)
+		{
+			if (tex->GenerateMips && level <= tex->image->mipLevels)
+				barrier.AddImage(tex->image.get(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_ASPECT_COLOR_BIT, level - 1);
+		}
+		barrier.Execute(cmdbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+		for (CachedTexture* tex : PendingUploads)
+		{
+			if (tex->GenerateMips && level < tex->image->mipLevels)
+			{
+				int srcWidth = std::max(tex->image->width >> (level - 1), 1);
+				int srcHeight = std::max(tex->image->height >> (level - 1), 1);
+				int dstWidth = std::max(tex->image->width >> level, 1);
+				int dstHeight = std::max(tex->image->height >> level, 1);
+
+				VkImageBlit blit = {};
+				blit.srcOffsets[1] = { srcWidth, srcHeight, 1 };
+				blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				blit.srcSubresource.mipLevel = level - 1;
+				blit.srcSubresource.layerCount = 1;
+				blit.dstOffsets[1] = { dstWidth, dstHeight, 1 };
+				blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				blit.dstSubresource.mipLevel = level;
+				blit.dstSubresource.layerCount = 1;
+				cmdbuffer->blitImage(tex->image->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, tex->image->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+			}
+		}
+	}
+
+	for (CachedTexture* tex : PendingUploads)
+	{
+		if (tex->GenerateMips)
+			tex->imageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	}
 }
 
 void UploadManager::SubmitUploads()
 {
+	// All conversion jobs must have written their data before the copies read it
+	Workers->WaitAll();
+
+	if (DiskCache)
+		DiskCache->Prune();
+
 	if (PendingUploads.empty())
 		return;
 
@@ -200,21 +1045,38 @@ void UploadManager::SubmitUploads()
 	for (int i = 0; i < 2; i++)
 	{
 		// Copy from buffer to images
-		VkBuffer buffer = renderer->Buffers->UploadBuffer->buffer;
+		std::vector<VkBufferImageCopy> regions;
 		for (CachedTexture* tex : PendingUploads)
 		{
-			if (!tex->pendingUploads[i].empty())
+			const std::vector<PendingTextureUpload>& uploads = tex->pendingUploads[i];
+			if (!uploads.empty())
 			{
 				if (i == 0)
 					renderer->Stats.Uploads++;
 				else
 					renderer->Stats.RectUploads++;
 
-				cmdbuffer->copyBufferToImage(buffer, tex->image->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, tex->pendingUploads[i].size(), tex->pendingUploads[i].data());
+				// One copy per run of regions sharing the same source buffer
+				size_t start = 0;
+				while (start < uploads.size())
+				{
+					size_t end = start + 1;
+					while (end < uploads.size() && uploads[end].buffer == uploads[start].buffer)
+						end++;
+
+					regions.clear();
+					for (size_t j = start; j < end; j++)
+						regions.push_back(uploads[j].region);
+					cmdbuffer->copyBufferToImage(uploads[start].buffer, tex->image->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regions.size(), regions.data());
+
+					start = end;
+				}
 			}
 		}
 	}
 
+	GenerateMipmaps(cmdbuffer);
+
 	// Transition images to texture sampling
 	PipelineBarrier afterBarrier;
 	for (CachedTexture* tex : PendingUploads)
@@ -240,5 +1102,12 @@ void UploadManager::SubmitUploads()
 		tex->inPendingUploads = false;
 	}
 	PendingUploads.clear();
-	UploadBufferPos = 0;
+
+	// The dedicated staging buffers can be released once the commands reading them have finished
+	for (auto& buffer : DedicatedUploadBuffers)
+	{
+		buffer->Unmap();
+		renderer->Commands->FrameDeleteList->buffers.push_back(std::move(buffer));
+	}
+	DedicatedUploadBuffers.clear();
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "TextureUploader.h"
+#include "WorkerPool.h"
+#include "TextureDiskCache.h"
 #include <unordered_map>
 
 class UVulkanRenderDevice;
@@ -17,19 +19,125 @@ public:
 
 	void UploadTexture(CachedTexture* tex, const FTextureInfo& Info, bool masked);
 	void UploadTextureRect(CachedTexture* tex, const FTextureInfo& Info, int x, int y, int w, int h);
+	void UploadPalette(CachedTexture* atlas, int row, const FColor* palette);
+
+	// Copies a w x h lightmap or fogmap into an atlas page at x, y, surrounded by a gutter replicating its edge texels
+	bool SupportsAtlasUpload(const FTextureInfo& Info) const;
+	void UploadAtlasRect(CachedTexture* atlas, const FTextureInfo& Info, int w, int h, int x, int y, int gutter);
+
+	// Uploads the next mips of streamed textures, up to the per-frame budget. Called once per frame before the commands are submitted.
+	void StreamMips();
+
+	// Must be called before a texture that may still be streaming is destroyed
+	void CancelStreaming(CachedTexture* tex);
 
 	void SubmitUploads();
 
+	// Called once the GPU finished all submitted work. Retires every upload batch. present tells that the submit ended a frame.
+	void UploadsFinished(bool present);
+
 	void ClearCache();
 
+	// Most of the ring buffer in use at once since startup, and the bytes staged or host copied by the submits of the last presented frame
+	size_t GetUploadBufferHighWater() const { return UploadBufferHighWater; }
+	size_t GetLastFrameUploadBytes() const { return LastFrameUploadBytes; }
+
 private:
-	void UploadData(CachedTexture* tex, const FTextureInfo& Info, bool masked, TextureUploader* uploader);
+	// Uploads the mip levels from firstmip up to, but not including, mipcount
+	void UploadData(CachedTexture* tex, const FTextureInfo& Info, bool masked, TextureUploader* uploader, int firstmip, int mipcount);
+	void HostCopyData(CachedTexture* tex, const FTextureInfo& Info, bool masked, TextureUploader* uploader);
+	bool SupportsHostImageCopy(VkFormat format);
 	void UploadWhite(CachedTexture* tex);
-	void WaitIfUploadBufferIsFull(int bytes);
-	void AddPendingUpload(CachedTexture* tex, const VkBufferImageCopy& region, bool isPartial);
+	void UploadMipRect(CachedTexture* tex, const FTextureInfo& Info, TextureUploader* uploader, bool masked, int x, int y, int w, int h);
+	bool UploadChangedTiles(CachedTexture* tex, const FTextureInfo& Info, TextureUploader* uploader, bool masked);
+	static int GetSourceBytesPerPixel(ETextureFormat format);
+
+	struct UploadRange
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		uint8_t* data = nullptr;
+		VkDeviceSize offset = 0;
+	};
+
+	UploadRange ReserveUpload(size_t bytes);
+	void SubmitUploadBatch();
+	void WaitForUploadRange(size_t start, size_t end);
+	void AddPendingUpload(CachedTexture* tex, VkBuffer buffer, const VkBufferImageCopy& region, bool isPartial);
+	VkFormat GetMipGenerationFormat(VkFormat format) const;
+	void GenerateMipmaps(VulkanCommandBuffer* cmdbuffer);
 
 	UVulkanRenderDevice* renderer = nullptr;
 
-	int UploadBufferPos = 0;
+	// Converts texture mips into their reserved upload buffer ranges. SubmitUploads waits for it before recording the copies.
+	std::unique_ptr<WorkerPool> Workers;
+
+	// Mips smaller than this are grouped into a single job per texture
+	enum { MinMipJobSize = 16 * 1024 };
+
+	// Realtime textures are compared against their last upload in tiles of this size
+	enum { DirtyTileSize = 16 };
+
+	// Compressed texture payloads from earlier runs. Only created when VkCompressTextures is on.
+	std::unique_ptr<TextureDiskCache> DiskCache;
+
+	// Whether the device can copy into images in the shader read layout from the host, and for which formats
+	bool HostImageCopy = false;
+	std::map<VkFormat, bool> HostImageCopyFormats;
+
+	// Whether the sRGB aliases of the 8-bit formats can be blitted with linear filtering
+	bool MipBlitRGBA8 = false;
+	bool MipBlitBGRA8 = false;
+
+	// The upload buffer is used as a ring. Uploads are submitted in batches of UploadBatchSize bytes, or fewer at a wrap or the end of the frame.
+	// Each batch stays in flight until its fence signals.
+	struct InFlightUploadBatch
+	{
+		size_t Start = 0;
+		size_t End = 0;
+		std::unique_ptr<VulkanFence> Fence;
+	};
+
+	size_t UploadBufferPos = 0;
+	size_t PendingRangeStart = 0;
+	std::deque<InFlightUploadBatch> InFlightUploads;
+	std::vector<std::unique_ptr<VulkanFence>> FreeFences;
+
+	size_t UploadBufferHighWater = 0;
+	size_t FrameUploadBytes = 0;
+	size_t LastFrameUploadBytes = 0;
+
+	// Uploads larger than this get a staging buffer of their own
+	enum { DedicatedUploadSize = 16 * 1024 * 1024 };
+
+	// Bytes of the ring submitted together. Smaller batches mean more submits but shorter waits when the ring wraps.
+	enum { UploadBatchSize = 4 * 1024 * 1024 };
+	std::vector<std::unique_ptr<VulkanBuffer>> DedicatedUploadBuffers;
+
 	std::vector<CachedTexture*> PendingUploads;
+
+	// Textures larger than this start out with only the mips up to this size. The rest is streamed in.
+	enum { StreamedMipSize = 256 };
+
+	struct StreamingTexture
+	{
+		CachedTexture* Texture = nullptr;
+		TextureUploader* Uploader = nullptr;
+		ETextureFormat Format;
+		bool Masked = false;
+		std::vector<FMipmapBase> Mips;
+		std::vector<std::shared_ptr<std::vector<BYTE>>> Sources; // Copies of the mip data the Mips point at. Each is released once its mip is converted.
+		std::shared_ptr<FColor> Palette;
+		int NextLevel = 0; // Counts down to zero as the mips get uploaded
+	};
+
+	void StartStreaming(CachedTexture* tex, const FTextureInfo& Info, bool masked, TextureUploader* uploader);
+	size_t StreamMip(StreamingTexture& streaming, int level);
+
+	std::deque<StreamingTexture> StreamingTextures;
+
+	// Textures whose last mips are part of the current submit. Their views are replaced in UploadsFinished.
+	std::vector<CachedTexture*> StreamedTextures;
+
+	// Scratch buffer for UploadAtlasRect
+	std::vector<uint32_t> AtlasPixels;
 };
@@ -0,0 +1,83 @@
+
+#include "Precomp.h"
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int numThreads)
+{
+	for (int i = 0; i < numThreads; i++)
+		Threads.push_back(std::thread([this]() { WorkerMain(); }));
+}
+
+WorkerPool::~WorkerPool()
+{
+	WaitAll();
+
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		StopFlag = true;
+	}
+	JobQueued.notify_all();
+	for (std::thread& thread : Threads)
+		thread.join();
+}
+
+int WorkerPool::GetDefaultThreadCount()
+{
+	int cores = (int)std::thread::hardware_concurrency();
+	return std::max(std::min(cores - 1, 8), 1);
+}
+
+void WorkerPool::Run(std::function<void()> job)
+{
+	if (Threads.empty())
+	{
+		job();
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		Jobs.push_back(std::move(job));
+	}
+	JobQueued.notify_one();
+}
+
+void WorkerPool::WaitAll()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	while (RunNextJob(lock))
+	{
+	}
+	JobsDone.wait(lock, [this]() { return ActiveJobs == 0; });
+}
+
+void WorkerPool::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	while (true)
+	{
+		JobQueued.wait(lock, [this]() { return StopFlag || !Jobs.empty(); });
+		if (StopFlag)
+			break;
+		RunNextJob(lock);
+	}
+}
+
+bool WorkerPool::RunNextJob(std::unique_lock<std::mutex>& lock)
+{
+	if (Jobs.empty())
+		return false;
+
+	std::function<void()> job = std::move(Jobs.front());
+	Jobs.pop_front();
+	ActiveJobs++;
+
+	lock.unlock();
+	job();
+	lock.lock();
+
+	ActiveJobs--;
+	if (ActiveJobs == 0 && Jobs.empty())
+		JobsDone.notify_all();
+	return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+
+// Fixed set of worker threads running jobs from a shared queue
+class WorkerPool
+{
+public:
+	WorkerPool(int numThreads);
+	~WorkerPool();
+
+	// Queues a job. With no worker threads the job runs immediately on the calling thread.
+	void Run(std::function<void()> job);
+
+	// Helps finish the queued jobs and returns once all of them have completed
+	void WaitAll();
+
+	int GetThreadCount() const { return (int)Threads.size(); }
+
+	// One less than the number of cores, leaving one for the render thread
+	static int GetDefaultThreadCount();
+
+private:
+	void WorkerMain();
+	bool RunNextJob(std::unique_lock<std::mutex>& lock);
+
+	std::vector<std::thread> Threads;
+	std::mutex Mutex;
+	std::condition_variable JobQueued;
+	std::condition_variable JobsDone;
+	std::deque<std::function<void()>> Jobs;
+	int ActiveJobs = 0;
+	bool StopFlag = false;
+};
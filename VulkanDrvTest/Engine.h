@@ -0,0 +1,120 @@
+#pragma once
+
+// Stand-in for the engine header, with just the types the texture uploaders use.
+// The test doesn't link against the game, so none of this has to match the engine beyond the names and the layouts.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+typedef uint8_t BYTE;
+typedef int32_t INT;
+
+struct FColor
+{
+	BYTE R, G, B, A;
+};
+
+struct FMipmapBase
+{
+	FMipmapBase(BYTE ubits, BYTE vbits) : DataPtr(nullptr), USize(1 << ubits), VSize(1 << vbits), UBits(ubits), VBits(vbits) { }
+	FMipmapBase() { }
+
+	BYTE* DataPtr;
+	INT USize, VSize;
+	BYTE UBits, VBits;
+};
+
+// Only the formats the uploaders handle
+enum ETextureFormat
+{
+	TEXF_P8 = 0,
+	TEXF_BGRA8_LM,
+	TEXF_R5G6B5,
+	TEXF_BC1,
+	TEXF_RGB8,
+	TEXF_BGRA8,
+	TEXF_BC2,
+	TEXF_BC3,
+	TEXF_BC4,
+	TEXF_BC4_S,
+	TEXF_BC5,
+	TEXF_BC5_S,
+	TEXF_BC7,
+	TEXF_BC6H_S,
+	TEXF_BC6H,
+	TEXF_RGBA16,
+	TEXF_RGBA16_S,
+	TEXF_BC1_PA,
+	TEXF_R8,
+	TEXF_R8_S,
+	TEXF_R16,
+	TEXF_R16_S,
+	TEXF_RG8,
+	TEXF_RG8_S,
+	TEXF_RG16,
+	TEXF_RG16_S,
+	TEXF_RGB8_S,
+	TEXF_RGB16_,
+	TEXF_RGB16_S,
+	TEXF_RGBA8_,
+	TEXF_RGBA8_S,
+	TEXF_R16_F,
+	TEXF_R32_F,
+	TEXF_RG16_F,
+	TEXF_RG32_F,
+	TEXF_RGB16_F,
+	TEXF_RGB32_F,
+	TEXF_RGBA16_F,
+	TEXF_RGBA32_F,
+	TEXF_ETC2,
+	TEXF_ETC2_PA,
+	TEXF_ETC2_RGB_EAC_A,
+	TEXF_EAC_R,
+	TEXF_EAC_R_S,
+	TEXF_EAC_RG,
+	TEXF_EAC_RG_S,
+	TEXF_ASTC_4x4,
+	TEXF_ASTC_5x4,
+	TEXF_ASTC_5x5,
+	TEXF_ASTC_6x5,
+	TEXF_ASTC_6x6,
+	TEXF_ASTC_8x5,
+	TEXF_ASTC_8x6,
+	TEXF_ASTC_8x8,
+	TEXF_ASTC_10x5,
+	TEXF_ASTC_10x6,
+	TEXF_ASTC_10x8,
+	TEXF_ASTC_10x10,
+	TEXF_ASTC_12x10,
+	TEXF_ASTC_12x12,
+	TEXF_R8_UI,
+	TEXF_R8_I,
+	TEXF_R16_UI,
+	TEXF_R16_I,
+	TEXF_R32_UI,
+	TEXF_R32_I,
+	TEXF_RG8_UI,
+	TEXF_RG8_I,
+	TEXF_RG16_UI,
+	TEXF_RG16_I,
+	TEXF_RG32_UI,
+	TEXF_RG32_I,
+	TEXF_RGB8_UI,
+	TEXF_RGB8_I,
+	TEXF_RGB16_UI,
+	TEXF_RGB16_I,
+	TEXF_RGB32_UI,
+	TEXF_RGB32_I,
+	TEXF_RGBA8_UI,
+	TEXF_RGBA8_I,
+	TEXF_RGBA16_UI,
+	TEXF_RGBA16_I,
+	TEXF_RGBA32_UI,
+	TEXF_RGBA32_I,
+	TEXF_RGB10A2,
+	TEXF_RGB10A2_UI,
+	TEXF_RGB10A2_LM,
+	TEXF_MAX = 0xff
+};
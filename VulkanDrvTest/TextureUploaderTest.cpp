@@ -0,0 +1,500 @@
+
+#include "Precomp.h"
+#include "TextureUploaderTest.h"
+#include "TextureUploader.h"
+#include <chrono>
+#include <cmath>
+
+bool TextureUploaderTest::Run(bool benchmark, std::vector<std::string>& output)
+{
+	std::vector<TestCase> tests;
+	auto addTest = [&](const std::string& name, TextureUploader* uploader, ETextureFormat format, bool hasReference, bool rawBytes)
+	{
+		for (const TestCase& test : tests)
+		{
+			if (test.Uploader == uploader)
+				return;
+		}
+		tests.push_back({ name, uploader, format, hasReference, rawBytes });
+	};
+
+	char name[128];
+	for (int format = 0; format < TEXF_MAX; format++)
+	{
+		TextureUploader* uploader = TextureUploader::GetUploader((ETextureFormat)format);
+		if (!uploader)
+			continue;
+
+		snprintf(name, sizeof(name), "Format %d (VkFormat %d)", format, (int)uploader->GetVkFormat());
+		addTest(name, uploader, (ETextureFormat)format, true, false);
+
+		for (bool alpha : { false, true })
+		{
+			if (TextureUploader* compressed = TextureUploader::GetCompressedUploader(uploader, alpha))
+			{
+				snprintf(name, sizeof(name), "Format %d as %s", format, alpha ? "BC3" : "BC1");
+				addTest(name, compressed, (ETextureFormat)format, false, false);
+			}
+		}
+	}
+	addTest("Palette indexes", TextureUploader::GetPaletteIndexUploader(), TEXF_P8, true, true);
+
+	// Every source format uses at most 16 bytes per texel, so one random buffer serves them all
+	std::vector<uint8_t> source(256 * 256 * 16);
+	uint32_t seed = 0x12345678;
+	auto random = [&]() { seed = seed * 1664525 + 1013904223; return seed >> 24; };
+	for (uint8_t& value : source)
+		value = (uint8_t)random();
+
+	FColor palette[256];
+	for (FColor& color : palette)
+	{
+		color.R = (BYTE)random();
+		color.G = (BYTE)random();
+		color.B = (BYTE)random();
+		color.A = (BYTE)random();
+	}
+
+	bool passed = true;
+	for (const TestCase& test : tests)
+	{
+		std::string error = Check(test, source, palette);
+		if (error.empty() && !test.HasReference)
+			error = CheckCompressed(test);
+		std::string result = error.empty() ? "ok" : "FAILED (" + error + ")";
+		passed = passed && error.empty();
+
+		if (benchmark)
+		{
+			snprintf(name, sizeof(name), ", %.1f MB/s", Benchmark(test.Uploader, source, palette));
+			result += name;
+		}
+		output.push_back(test.Name + ": " + result);
+	}
+
+	std::vector<std::pair<const char*, PaletteExpandFunc>> expandFuncs = TextureUploader_P8::GetExpandFuncs();
+	for (size_t i = 0; i < expandFuncs.size(); i++)
+	{
+		std::string error = CheckPaletteExpand(expandFuncs[i].second, palette);
+		passed = passed && error.empty();
+		output.push_back(std::string("Palette lookup (") + expandFuncs[i].first + "): " + (error.empty() ? "ok" : "FAILED (" + error + ")"));
+	}
+
+	return passed;
+}
+
+TextureUploaderTest::Layout TextureUploaderTest::GetLayout(TextureUploader* uploader)
+{
+	// The output grows by one block whenever the rectangle crosses into the next block
+	Layout layout;
+	layout.BytesPerBlock = uploader->GetUploadSize(0, 0, 1, 1);
+	while (uploader->GetUploadSize(0, 0, layout.BlockX + 1, 1) == layout.BytesPerBlock)
+		layout.BlockX++;
+	while (uploader->GetUploadSize(0, 0, 1, layout.BlockY + 1) == layout.BytesPerBlock)
+		layout.BlockY++;
+	return layout;
+}
+
+// Rounds a value in the 0 to 1 range to an unsigned normalized integer, like the Vulkan spec converts floats to UNORM
+static uint32_t ToUnorm(double value, uint32_t maxValue)
+{
+	value = std::min(std::max(value, 0.0), 1.0);
+	return (uint32_t)std::floor(value * maxValue + 0.5);
+}
+
+// The reference is written from what the texture formats store, not from how the uploaders convert them.
+// Lightmap formats store half the light intensity so that they can brighten the surface up to twice its texture color.
+void TextureUploaderTest::GetReference(const TestCase& test, FMipmapBase* mip, FColor* palette, bool masked, std::vector<uint8_t>& output)
+{
+	int count = mip->USize * mip->VSize;
+	const BYTE* src = mip->DataPtr;
+	BYTE* dst = output.data();
+
+	if (test.RawBytes)
+	{
+		memcpy(dst, src, count);
+		return;
+	}
+
+	switch (test.Format)
+	{
+	case TEXF_P8:
+		// Palette indexes into RGBA colors. Masked textures draw index 0 as transparent black.
+		for (int i = 0; i < count; i++)
+		{
+			BYTE index = src[i];
+			FColor color = palette[index];
+			bool transparent = masked && index == 0;
+			dst[i * 4 + 0] = transparent ? 0 : color.R;
+			dst[i * 4 + 1] = transparent ? 0 : color.G;
+			dst[i * 4 + 2] = transparent ? 0 : color.B;
+			dst[i * 4 + 3] = transparent ? 0 : color.A;
+		}
+		break;
+
+#if defined(OLDUNREAL469SDK)
+	case TEXF_BGRA8_LM:
+#else
+	case TEXF_RGBA7:
+#endif
+		// 8-bit lightmap texels in B, G, R, A byte order, uploaded as R8G8B8A8_UNORM
+		for (int i = 0; i < count; i++)
+		{
+			const BYTE* texel = src + i * 4;
+			const BYTE rgba[4] = { texel[2], texel[1], texel[0], texel[3] };
+			for (int j = 0; j < 4; j++)
+				dst[i * 4 + j] = (BYTE)ToUnorm(2.0 * rgba[j] / 255.0, 0xff);
+		}
+		break;
+
+#if defined(OLDUNREAL469SDK)
+	case TEXF_RGB10A2:
+	case TEXF_RGB10A2_UI:
+	case TEXF_RGB10A2_LM:
+		// 32-bit texels with red in the top 10 bits and alpha in the bottom 2, uploaded as 16 bits per channel
+		for (int i = 0; i < count; i++)
+		{
+			uint32_t texel;
+			memcpy(&texel, src + i * 4, sizeof(uint32_t));
+			const uint32_t rgba[4] = { texel >> 22, (texel >> 12) & 0x3ff, (texel >> 2) & 0x3ff, texel & 0x3 };
+
+			for (int j = 0; j < 4; j++)
+			{
+				uint32_t maxValue = (j == 3) ? 0x3 : 0x3ff;
+				uint16_t value;
+				if (test.Format == TEXF_RGB10A2_UI)
+					value = (uint16_t)rgba[j];
+				else if (test.Format == TEXF_RGB10A2_LM)
+					value = (uint16_t)ToUnorm(2.0 * rgba[j] / maxValue, 0xffff);
+				else
+					value = (uint16_t)ToUnorm((double)rgba[j] / maxValue, 0xffff);
+				memcpy(dst + i * 8 + j * 2, &value, sizeof(uint16_t));
+			}
+		}
+		break;
+#endif
+
+	default:
+		// Everything else is stored exactly as the Vulkan format expects it
+		memcpy(dst, src, output.size());
+		break;
+	}
+}
+
+std::string TextureUploaderTest::Check(const TestCase& test, std::vector<uint8_t>& source, FColor* palette)
+{
+	TextureUploader* uploader = test.Uploader;
+
+	FMipmapBase mip(6, 5);
+	mip.DataPtr = source.data();
+
+	Layout layout = GetLayout(uploader);
+	int pitchBlocks = (mip.USize + layout.BlockX - 1) / layout.BlockX;
+
+	// Covers the SIMD and scalar paths, unaligned starts, partial blocks and the mip edges
+	struct Rect { int X, Y, W, H; };
+	static const Rect rects[] =
+	{
+		{ 0, 0, 64, 32 }, { 0, 0, 1, 1 }, { 1, 1, 5, 3 }, { 3, 2, 17, 9 }, { 4, 4, 8, 8 },
+		{ 16, 8, 32, 16 }, { 57, 27, 7, 5 }, { 60, 0, 4, 32 }, { 0, 31, 64, 1 }, { 13, 0, 1, 32 }
+	};
+
+	char message[128];
+	for (bool masked : { false, true })
+	{
+		const char* mode = masked ? "masked" : "unmasked";
+
+		std::vector<uint8_t> full(uploader->GetUploadSize(0, 0, mip.USize, mip.VSize));
+		uploader->UploadRect(full.data(), &mip, 0, 0, mip.USize, mip.VSize, palette, masked);
+
+		if (test.HasReference)
+		{
+			std::vector<uint8_t> reference(full.size());
+			GetReference(test, &mip, palette, masked, reference);
+			if (full != reference)
+			{
+				snprintf(message, sizeof(message), "full upload differs from the reference, %s", mode);
+				return message;
+			}
+		}
+
+		for (const Rect& rect : rects)
+		{
+			int x0 = rect.X / layout.BlockX;
+			int y0 = rect.Y / layout.BlockY;
+			int x1 = (rect.X + rect.W + layout.BlockX - 1) / layout.BlockX;
+			int y1 = (rect.Y + rect.H + layout.BlockY - 1) / layout.BlockY;
+			size_t rowSize = (x1 - x0) * layout.BytesPerBlock;
+
+			std::vector<uint8_t> output(uploader->GetUploadSize(rect.X, rect.Y, rect.W, rect.H));
+			bool sizeMatches = output.size() == rowSize * (y1 - y0);
+			if (sizeMatches)
+				uploader->UploadRect(output.data(), &mip, rect.X, rect.Y, rect.W, rect.H, palette, masked);
+
+			bool match = sizeMatches;
+			for (int y = y0; match && y < y1; y++)
+			{
+				const uint8_t* expected = full.data() + (y * pitchBlocks + x0) * layout.BytesPerBlock;
+				match = memcmp(output.data() + (y - y0) * rowSize, expected, rowSize) == 0;
+			}
+
+			if (!match)
+			{
+				snprintf(message, sizeof(message), "%s rect %d,%d %dx%d, %s", sizeMatches ? "content of" : "size of", rect.X, rect.Y, rect.W, rect.H, mode);
+				return message;
+			}
+		}
+	}
+	return {};
+}
+
+// Decodes a BC1 color block to RGBA. BC3 color blocks always use four colors, BC1 only when the first endpoint is the larger one.
+// Returns whether the block used the four color mode.
+static bool DecodeColorBlock(const uint8_t* block, bool alwaysFourColors, uint8_t* rgba)
+{
+	int c0 = block[0] | (block[1] << 8);
+	int c1 = block[2] | (block[3] << 8);
+	bool fourColors = alwaysFourColors || c0 > c1;
+
+	int colors[4][4];
+	for (int k = 0; k < 2; k++)
+	{
+		int c = (k == 0) ? c0 : c1;
+		int r = (c >> 11) & 31;
+		int g = (c >> 5) & 63;
+		int b = c & 31;
+		colors[k][0] = (r << 3) | (r >> 2);
+		colors[k][1] = (g << 2) | (g >> 4);
+		colors[k][2] = (b << 3) | (b >> 2);
+		colors[k][3] = 255;
+	}
+	for (int j = 0; j < 3; j++)
+	{
+		if (fourColors)
+		{
+			colors[2][j] = (2 * colors[0][j] + colors[1][j]) / 3;
+			colors[3][j] = (colors[0][j] + 2 * colors[1][j]) / 3;
+		}
+		else
+		{
+			colors[2][j] = (colors[0][j] + colors[1][j]) / 2;
+			colors[3][j] = 0;
+		}
+	}
+	colors[2][3] = 255;
+	colors[3][3] = fourColors ? 255 : 0;
+
+	uint32_t indexes = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+	for (int i = 0; i < 16; i++)
+	{
+		const int* color = colors[(indexes >> (i * 2)) & 3];
+		for (int j = 0; j < 4; j++)
+			rgba[i * 4 + j] = (uint8_t)color[j];
+	}
+	return fourColors;
+}
+
+// Decodes a BC3 alpha block into the alpha channel of RGBA pixels
+static void DecodeAlphaBlock(const uint8_t* block, uint8_t* rgba)
+{
+	int a0 = block[0];
+	int a1 = block[1];
+	int alphas[8] = { a0, a1 };
+	if (a0 > a1)
+	{
+		for (int k = 1; k < 7; k++)
+			alphas[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+	}
+	else
+	{
+		for (int k = 1; k < 5; k++)
+			alphas[k + 1] = ((5 - k) * a0 + k * a1) / 5;
+		alphas[6] = 0;
+		alphas[7] = 255;
+	}
+
+	uint64_t indexes = 0;
+	for (int i = 0; i < 6; i++)
+		indexes |= (uint64_t)block[2 + i] << (i * 8);
+	for (int i = 0; i < 16; i++)
+		rgba[i * 4 + 3] = (uint8_t)alphas[(indexes >> (i * 3)) & 7];
+}
+
+// Block compression is lossy, so the decoded output only has to stay close to the reference of the source format.
+// Random texels would compress badly no matter how good the encoder is. The input is a smooth gradient instead.
+std::string TextureUploaderTest::CheckCompressed(const TestCase& test)
+{
+	TextureUploader* source = TextureUploader::GetUploader(test.Format);
+	bool alpha = test.Uploader->GetVkFormat() == VK_FORMAT_BC3_UNORM_BLOCK;
+	int redIndex = (source->GetVkFormat() == VK_FORMAT_B8G8R8A8_UNORM) ? 2 : 0;
+	int blockSize = alpha ? 16 : 8;
+
+	// Largest difference allowed in any channel. Quantizing the endpoints to RGB565 alone can be off by 4.
+	const int maxError = 8;
+
+	FMipmapBase mip(6, 5);
+	int texelSize = source->GetSourceSize(mip.USize, mip.VSize) / (mip.USize * mip.VSize);
+	std::vector<uint8_t> data(source->GetSourceSize(mip.USize, mip.VSize));
+	mip.DataPtr = data.data();
+
+	FColor palette[256];
+	for (int i = 0; i < 256; i++)
+	{
+		palette[i].R = (BYTE)i;
+		palette[i].G = (BYTE)(255 - i);
+		palette[i].B = (BYTE)(64 + i / 2);
+		palette[i].A = 255;
+	}
+
+	TestCase sourceTest = { test.Name, source, test.Format, true, false };
+
+	char message[128];
+	for (bool masked : { false, true })
+	{
+		const char* mode = masked ? "masked" : "unmasked";
+
+		// Masked palette textures draw index 0 as transparent. Scattering it over the texture mixes transparent and opaque texels in some blocks.
+		bool holes = masked && !alpha && test.Format == TEXF_P8;
+		for (int y = 0; y < mip.VSize; y++)
+		{
+			for (int x = 0; x < mip.USize; x++)
+			{
+				uint8_t* texel = data.data() + (x + y * mip.USize) * texelSize;
+				if (texelSize == 1)
+				{
+					texel[0] = (holes && (x * 3 + y) % 7 == 0) ? 0 : (uint8_t)(1 + x * 2 + y);
+					continue;
+				}
+
+				// Kept below 128 so that the lightmap formats, which double the texels, don't saturate. Alpha ramps from 0 to 252.
+				for (int k = 0; k < texelSize; k++)
+					texel[k] = (k % 4 == 3) ? (uint8_t)(x * 4) : (uint8_t)((x * (k % 4 + 1) + y * (4 - k % 4)) / 4 + 16 + 8 * (k % 4));
+			}
+		}
+
+		std::vector<uint8_t> reference(source->GetUploadSize(0, 0, mip.USize, mip.VSize));
+		GetReference(sourceTest, &mip, palette, masked, reference);
+
+		std::vector<uint8_t> compressed(test.Uploader->GetUploadSize(0, 0, mip.USize, mip.VSize));
+		test.Uploader->UploadRect(compressed.data(), &mip, 0, 0, mip.USize, mip.VSize, palette, masked);
+
+		int blocksX = mip.USize / 4;
+		int error = 0;
+		for (int by = 0; by < mip.VSize / 4; by++)
+		{
+			for (int bx = 0; bx < blocksX; bx++)
+			{
+				const uint8_t* block = compressed.data() + (bx + by * blocksX) * blockSize;
+				uint8_t decoded[16 * 4];
+				bool fourColors = DecodeColorBlock(alpha ? block + 8 : block, alpha, decoded);
+				if (alpha)
+					DecodeAlphaBlock(block, decoded);
+
+				bool opaque = true;
+				for (int i = 0; i < 16; i++)
+				{
+					int x = bx * 4 + (i & 3);
+					int y = by * 4 + (i >> 2);
+					const uint8_t* texel = reference.data() + (x + y * mip.USize) * 4;
+					const uint8_t expected[4] = { texel[redIndex], texel[1], texel[2 - redIndex], texel[3] };
+					const uint8_t* actual = decoded + i * 4;
+
+					// BC1 has no alpha channel. Masked texels with alpha below 128 become transparent black, all other texels opaque.
+					int channels = 4;
+					if (!alpha)
+					{
+						bool transparent = masked && expected[3] < 128;
+						opaque = opaque && !transparent;
+						if (transparent ? (actual[0] || actual[1] || actual[2] || actual[3]) : actual[3] != 255)
+						{
+							snprintf(message, sizeof(message), "texel %d,%d should be %s, %s", x, y, transparent ? "transparent black" : "opaque", mode);
+							return message;
+						}
+						if (transparent)
+							continue;
+						channels = 3;
+					}
+
+					for (int j = 0; j < channels; j++)
+						error = std::max(error, std::abs(actual[j] - expected[j]));
+				}
+
+				if (!alpha && opaque && !fourColors)
+				{
+					snprintf(message, sizeof(message), "opaque block %d,%d uses the three color mode, %s", bx, by, mode);
+					return message;
+				}
+			}
+		}
+
+		if (error > maxError)
+		{
+			snprintf(message, sizeof(message), "decoded texels are off by up to %d, %s", error, mode);
+			return message;
+		}
+	}
+	return {};
+}
+
+std::string TextureUploaderTest::CheckPaletteExpand(PaletteExpandFunc expand, FColor* palette)
+{
+	// Every index in a shuffled order, followed by a run that repeats index 0 and 255 for the masked entry and the table end
+	std::vector<BYTE> src(256 + 37);
+	for (int i = 0; i < 256; i++)
+		src[i] = (BYTE)(i * 167 + 13);
+	for (size_t i = 256; i < src.size(); i++)
+		src[i] = (i & 1) ? 0 : 255;
+
+	// Guard values behind the output catch kernels writing past count
+	const uint32_t guard = 0xdeadbeef;
+	const int guardCount = 16;
+	std::vector<uint32_t> expected(src.size() + guardCount), actual(src.size() + guardCount);
+
+	char message[128];
+	for (bool masked : { false, true })
+	{
+		uint32_t table[256];
+		TextureUploader_P8::GetExpandTable(table, palette, masked);
+
+		// All lengths from every start offset within a vector covers the SIMD loop and every possible tail
+		for (int offset = 0; offset < 8; offset++)
+		{
+			for (int count = 0; offset + count <= (int)src.size(); count++)
+			{
+				std::fill(expected.begin(), expected.end(), guard);
+				std::fill(actual.begin(), actual.end(), guard);
+				for (int i = 0; i < count; i++)
+					expected[i] = (masked && src[offset + i] == 0) ? 0 : *(uint32_t*)&palette[src[offset + i]];
+
+				expand(actual.data(), src.data() + offset, count, table);
+				if (actual != expected)
+				{
+					snprintf(message, sizeof(message), "%d indexes from offset %d, %s", count, offset, masked ? "masked" : "unmasked");
+					return message;
+				}
+			}
+		}
+	}
+	return {};
+}
+
+double TextureUploaderTest::Benchmark(TextureUploader* uploader, std::vector<uint8_t>& source, FColor* palette)
+{
+	FMipmapBase mip(8, 8);
+	mip.DataPtr = source.data();
+
+	std::vector<uint8_t> output(uploader->GetUploadSize(0, 0, mip.USize, mip.VSize));
+
+	// Run for at least 50 ms to get past timer resolution and cache warmup
+	auto start = std::chrono::steady_clock::now();
+	double seconds = 0.0;
+	int iterations = 0;
+	do
+	{
+		uploader->UploadRect(output.data(), &mip, 0, 0, mip.USize, mip.VSize, palette, false);
+		iterations++;
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	} while (seconds < 0.05 || iterations < 4);
+
+	return output.size() * (double)iterations / seconds / (1024.0 * 1024.0);
+}
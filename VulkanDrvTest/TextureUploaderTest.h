@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include "TextureUploader.h"
+
+// Runs every texture uploader on generated mips and compares the output against a reference conversion,
+// for both mask modes and a set of sub-rectangles. Optionally measures how fast each uploader converts.
+// Uploaders compressing to BC1 or BC3 are checked by decoding their output and comparing it with the reference of their source format.
+// Also checks that every palette lookup kernel, scalar and SIMD, gives exactly the palette colors.
+class TextureUploaderTest
+{
+public:
+	// Adds one line per uploader to output. Returns false if any uploader failed.
+	static bool Run(bool benchmark, std::vector<std::string>& output);
+
+private:
+	struct TestCase
+	{
+		std::string Name;
+		TextureUploader* Uploader;
+		ETextureFormat Format;
+
+		// Uploaders compressing on the fly have no exact reference. CheckCompressed decodes them instead.
+		bool HasReference;
+		// The palette index uploader copies the P8 indexes instead of looking them up
+		bool RawBytes;
+	};
+
+	struct Layout
+	{
+		int BlockX = 1;
+		int BlockY = 1;
+		int BytesPerBlock = 0;
+	};
+
+	static Layout GetLayout(TextureUploader* uploader);
+	static void GetReference(const TestCase& test, FMipmapBase* mip, FColor* palette, bool masked, std::vector<uint8_t>& output);
+	// Returns what went wrong, or an empty string if the uploader passed
+	static std::string Check(const TestCase& test, std::vector<uint8_t>& source, FColor* palette);
+	static std::string CheckCompressed(const TestCase& test);
+	static std::string CheckPaletteExpand(PaletteExpandFunc expand, FColor* palette);
+	static double Benchmark(TextureUploader* uploader, std::vector<uint8_t>& source, FColor* palette);
+};
@@ -0,0 +1,3 @@
+#pragma once
+
+// Stand-in for the engine header. The texture uploaders don't need anything from it.
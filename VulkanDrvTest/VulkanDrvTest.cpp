@@ -0,0 +1,17 @@
+
+#include "Precomp.h"
+#include "TextureUploaderTest.h"
+
+// Runs the driver code that doesn't need the game or a GPU. Pass -bench to also measure the uploaders.
+int main(int argc, char** argv)
+{
+	bool benchmark = argc > 1 && strcmp(argv[1], "-bench") == 0;
+
+	std::vector<std::string> lines;
+	bool passed = TextureUploaderTest::Run(benchmark, lines);
+	for (const std::string& line : lines)
+		printf("%s\n", line.c_str());
+
+	printf("%s\n", passed ? "All tests passed" : "Some tests FAILED");
+	return passed ? 0 : 1;
+}
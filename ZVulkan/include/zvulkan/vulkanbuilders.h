@@ -52,6 +52,9 @@ public:
 	VulkanDeviceBuilder& OptionalExtension(const std::string& extensionName);
 	VulkanDeviceBuilder& OptionalRayQuery();
 	VulkanDeviceBuilder& OptionalDescriptorIndexing();
+	VulkanDeviceBuilder& OptionalDynamicRendering();
+	VulkanDeviceBuilder& OptionalHostImageCopy();
+	VulkanDeviceBuilder& OptionalPresentWait();
 	VulkanDeviceBuilder& Surface(std::shared_ptr<VulkanSurface> surface);
 	VulkanDeviceBuilder& SelectDevice(int index);
 
@@ -377,6 +380,8 @@ public:
 	GraphicsPipelineBuilder& Subpass(int subpass);
 	GraphicsPipelineBuilder& Layout(VulkanPipelineLayout *layout);
 	GraphicsPipelineBuilder& RenderPass(VulkanRenderPass *renderPass);
+	GraphicsPipelineBuilder& AddColorAttachmentFormat(VkFormat format);
+	GraphicsPipelineBuilder& DepthStencilAttachmentFormat(VkFormat depthFormat, VkFormat stencilFormat = VK_FORMAT_UNDEFINED);
 	GraphicsPipelineBuilder& Topology(VkPrimitiveTopology topology);
 	GraphicsPipelineBuilder& Viewport(float x, float y, float width, float height, float minDepth = 0.0f, float maxDepth = 1.0f);
 	GraphicsPipelineBuilder& Scissor(int x, int y, int width, int height);
@@ -415,8 +420,10 @@ private:
 	VkPipelineColorBlendStateCreateInfo colorBlending = { };
 	VkPipelineDepthStencilStateCreateInfo depthStencil = { };
 	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	VkPipelineRenderingCreateInfoKHR renderingInfo = {};
 
 	std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+	std::vector<VkFormat> colorAttachmentFormats;
 	std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments;
 	std::vector<VkVertexInputBindingDescription> vertexInputBindings;
 	std::vector<VkVertexInputAttributeDescription> vertexInputAttributes;
@@ -475,6 +482,7 @@ public:
 
 	RenderPassBuilder& AddSubpass();
 	RenderPassBuilder& AddSubpassColorAttachmentRef(uint32_t index, VkImageLayout layout);
+	RenderPassBuilder& AddSubpassResolveAttachmentRef(uint32_t index, VkImageLayout layout);
 	RenderPassBuilder& AddSubpassDepthStencilAttachmentRef(uint32_t index, VkImageLayout layout);
 
 	RenderPassBuilder& DebugName(const char* name) { debugName = name; return *this; }
@@ -491,6 +499,7 @@ private:
 	struct SubpassData
 	{
 		std::vector<VkAttachmentReference> colorRefs;
+		std::vector<VkAttachmentReference> resolveRefs;
 		VkAttachmentReference depthRef = { };
 	};
 
@@ -544,6 +553,8 @@ public:
 	WriteDescriptors& AddStorageImage(VulkanDescriptorSet *descriptorSet, int binding, VulkanImageView *view, VkImageLayout imageLayout);
 	WriteDescriptors& AddCombinedImageSampler(VulkanDescriptorSet *descriptorSet, int binding, VulkanImageView *view, VulkanSampler *sampler, VkImageLayout imageLayout);
 	WriteDescriptors& AddCombinedImageSampler(VulkanDescriptorSet* descriptorSet, int binding, int arrayIndex, VulkanImageView* view, VulkanSampler* sampler, VkImageLayout imageLayout);
+	WriteDescriptors& AddSampledImage(VulkanDescriptorSet* descriptorSet, int binding, int arrayIndex, VulkanImageView* view, VkImageLayout imageLayout);
+	WriteDescriptors& AddSampler(VulkanDescriptorSet* descriptorSet, int binding, int arrayIndex, VulkanSampler* sampler);
 	WriteDescriptors& AddAccelerationStructure(VulkanDescriptorSet* descriptorSet, int binding, VulkanAccelerationStructure* accelStruct);
 	void Execute(VulkanDevice *device);
 
@@ -360,6 +360,26 @@ private:
 	std::vector<VkClearValue> clearValues;
 };
 
+class RenderingBegin
+{
+public:
+	RenderingBegin();
+
+	RenderingBegin& Flags(VkRenderingFlagsKHR flags);
+	RenderingBegin& RenderArea(int x, int y, int width, int height);
+	RenderingBegin& AddColorAttachment(VulkanImageView* view, VkImageLayout layout, VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp, float r = 0.0f, float g = 0.0f, float b = 0.0f, float a = 0.0f);
+	RenderingBegin& ColorResolve(VulkanImageView* view, VkImageLayout layout, VkResolveModeFlagBits resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT_KHR);
+	RenderingBegin& DepthAttachment(VulkanImageView* view, VkImageLayout layout, VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp, float clearDepth = 1.0f);
+
+	void Execute(VulkanCommandBuffer* cmdbuffer);
+
+	VkRenderingInfoKHR renderingInfo = {};
+
+private:
+	std::vector<VkRenderingAttachmentInfoKHR> colorAttachments;
+	VkRenderingAttachmentInfoKHR depthAttachment = {};
+};
+
 class VulkanCommandBuffer
 {
 public:
@@ -424,6 +444,8 @@ public:
 	void beginRenderPass(const VkRenderPassBeginInfo* pRenderPassBegin, VkSubpassContents contents);
 	void nextSubpass(VkSubpassContents contents);
 	void endRenderPass();
+	void beginRendering(const VkRenderingInfoKHR* pRenderingInfo);
+	void endRendering();
 	void executeCommands(uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers);
 
 	void buildAccelerationStructures(uint32_t infoCount, const VkAccelerationStructureBuildGeometryInfoKHR* pInfos, const VkAccelerationStructureBuildRangeInfoKHR* const* ppBuildRangeInfos);
@@ -618,6 +640,69 @@ inline void RenderPassBegin::Execute(VulkanCommandBuffer* cmdbuffer, VkSubpassCo
 
 /////////////////////////////////////////////////////////////////////////////
 
+inline RenderingBegin::RenderingBegin()
+{
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+	renderingInfo.layerCount = 1;
+	depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+}
+
+inline RenderingBegin& RenderingBegin::Flags(VkRenderingFlagsKHR flags)
+{
+	renderingInfo.flags = flags;
+	return *this;
+}
+
+inline RenderingBegin& RenderingBegin::RenderArea(int x, int y, int width, int height)
+{
+	renderingInfo.renderArea.offset.x = x;
+	renderingInfo.renderArea.offset.y = y;
+	renderingInfo.renderArea.extent.width = width;
+	renderingInfo.renderArea.extent.height = height;
+	return *this;
+}
+
+inline RenderingBegin& RenderingBegin::AddColorAttachment(VulkanImageView* view, VkImageLayout layout, VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp, float r, float g, float b, float a)
+{
+	VkRenderingAttachmentInfoKHR attachment = { VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR };
+	attachment.imageView = view->view;
+	attachment.imageLayout = layout;
+	attachment.loadOp = loadOp;
+	attachment.storeOp = storeOp;
+	attachment.clearValue.color = { r, g, b, a };
+	colorAttachments.push_back(attachment);
+	return *this;
+}
+
+inline RenderingBegin& RenderingBegin::ColorResolve(VulkanImageView* view, VkImageLayout layout, VkResolveModeFlagBits resolveMode)
+{
+	auto& attachment = colorAttachments.back();
+	attachment.resolveMode = resolveMode;
+	attachment.resolveImageView = view->view;
+	attachment.resolveImageLayout = layout;
+	return *this;
+}
+
+inline RenderingBegin& RenderingBegin::DepthAttachment(VulkanImageView* view, VkImageLayout layout, VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp, float clearDepth)
+{
+	depthAttachment.imageView = view->view;
+	depthAttachment.imageLayout = layout;
+	depthAttachment.loadOp = loadOp;
+	depthAttachment.storeOp = storeOp;
+	depthAttachment.clearValue.depthStencil.depth = clearDepth;
+	renderingInfo.pDepthAttachment = &depthAttachment;
+	return *this;
+}
+
+inline void RenderingBegin::Execute(VulkanCommandBuffer* cmdbuffer)
+{
+	renderingInfo.colorAttachmentCount = (uint32_t)colorAttachments.size();
+	renderingInfo.pColorAttachments = colorAttachments.data();
+	cmdbuffer->beginRendering(&renderingInfo);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
 inline VulkanCommandBuffer::VulkanCommandBuffer(VulkanCommandPool *pool) : pool(pool)
 {
 	VkCommandBufferAllocateInfo allocInfo = {};
@@ -961,6 +1046,16 @@ inline void VulkanCommandBuffer::endRenderPass()
 	vkCmdEndRenderPass(buffer);
 }
 
+inline void VulkanCommandBuffer::beginRendering(const VkRenderingInfoKHR* pRenderingInfo)
+{
+	vkCmdBeginRenderingKHR(buffer, pRenderingInfo);
+}
+
+inline void VulkanCommandBuffer::endRendering()
+{
+	vkCmdEndRenderingKHR(buffer);
+}
+
 inline void VulkanCommandBuffer::executeCommands(uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers)
 {
 	vkCmdExecuteCommands(buffer, commandBufferCount, pCommandBuffers);
@@ -37,7 +37,10 @@ public:
 	VulkanImageView* GetImageView(int index) { return views[index].get(); }
 
 	int AcquireImage(VulkanSemaphore* semaphore = nullptr, VulkanFence* fence = nullptr);
-	void QueuePresent(int imageIndex, VulkanSemaphore* semaphore = nullptr);
+	void QueuePresent(int imageIndex, VulkanSemaphore* semaphore = nullptr, uint64_t presentId = 0);
+
+	// Requires VK_KHR_present_wait. Returns false if the timeout ran out or the swap chain got lost.
+	bool WaitForPresent(uint64_t presentId, uint64_t timeout);
 
 private:
 	void SelectFormat(const VulkanSurfaceCapabilities& caps, bool hdr);
@@ -895,6 +895,8 @@ GraphicsPipelineBuilder::GraphicsPipelineBuilder()
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 	pipelineInfo.basePipelineIndex = -1;
 
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	vertexInputInfo.vertexBindingDescriptionCount = 0;
 	vertexInputInfo.pVertexBindingDescriptions = nullptr;
@@ -981,6 +983,23 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::RenderPass(VulkanRenderPass* r
 	return *this;
 }
 
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::AddColorAttachmentFormat(VkFormat format)
+{
+	colorAttachmentFormats.push_back(format);
+	renderingInfo.colorAttachmentCount = (uint32_t)colorAttachmentFormats.size();
+	renderingInfo.pColorAttachmentFormats = colorAttachmentFormats.data();
+	pipelineInfo.pNext = &renderingInfo;
+	return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::DepthStencilAttachmentFormat(VkFormat depthFormat, VkFormat stencilFormat)
+{
+	renderingInfo.depthAttachmentFormat = depthFormat;
+	renderingInfo.stencilAttachmentFormat = stencilFormat;
+	pipelineInfo.pNext = &renderingInfo;
+	return *this;
+}
+
 GraphicsPipelineBuilder& GraphicsPipelineBuilder::Topology(VkPrimitiveTopology topology)
 {
 	inputAssembly.topology = topology;
@@ -1316,6 +1335,18 @@ RenderPassBuilder& RenderPassBuilder::AddSubpassColorAttachmentRef(uint32_t inde
 	return *this;
 }
 
+RenderPassBuilder& RenderPassBuilder::AddSubpassResolveAttachmentRef(uint32_t index, VkImageLayout layout)
+{
+	// Resolve references are parallel to the color references. Use VK_ATTACHMENT_UNUSED for color attachments that should not be resolved.
+	VkAttachmentReference resolveAttachmentRef = {};
+	resolveAttachmentRef.attachment = index;
+	resolveAttachmentRef.layout = layout;
+
+	subpassData.back()->resolveRefs.push_back(resolveAttachmentRef);
+	subpasses.back().pResolveAttachments = subpassData.back()->resolveRefs.data();
+	return *this;
+}
+
 RenderPassBuilder& RenderPassBuilder::AddSubpassDepthStencilAttachmentRef(uint32_t index, VkImageLayout layout)
 {
 	VkAttachmentReference& depthAttachmentRef = subpassData.back()->depthRef;
@@ -1557,6 +1588,49 @@ WriteDescriptors& WriteDescriptors::AddCombinedImageSampler(VulkanDescriptorSet*
 	return *this;
 }
 
+WriteDescriptors& WriteDescriptors::AddSampledImage(VulkanDescriptorSet* descriptorSet, int binding, int arrayIndex, VulkanImageView* view, VkImageLayout imageLayout)
+{
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.imageView = view->view;
+	imageInfo.imageLayout = imageLayout;
+
+	auto extra = std::make_unique<WriteExtra>();
+	extra->imageInfo = imageInfo;
+
+	VkWriteDescriptorSet descriptorWrite = {};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = descriptorSet->set;
+	descriptorWrite.dstBinding = binding;
+	descriptorWrite.dstArrayElement = arrayIndex;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pImageInfo = &extra->imageInfo;
+	writes.push_back(descriptorWrite);
+	writeExtras.push_back(std::move(extra));
+	return *this;
+}
+
+WriteDescriptors& WriteDescriptors::AddSampler(VulkanDescriptorSet* descriptorSet, int binding, int arrayIndex, VulkanSampler* sampler)
+{
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.sampler = sampler->sampler;
+
+	auto extra = std::make_unique<WriteExtra>();
+	extra->imageInfo = imageInfo;
+
+	VkWriteDescriptorSet descriptorWrite = {};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = descriptorSet->set;
+	descriptorWrite.dstBinding = binding;
+	descriptorWrite.dstArrayElement = arrayIndex;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pImageInfo = &extra->imageInfo;
+	writes.push_back(descriptorWrite);
+	writeExtras.push_back(std::move(extra));
+	return *this;
+}
+
 WriteDescriptors& WriteDescriptors::AddAccelerationStructure(VulkanDescriptorSet* descriptorSet, int binding, VulkanAccelerationStructure* accelStruct)
 {
 	auto extra = std::make_unique<WriteExtra>();
@@ -1708,6 +1782,31 @@ VulkanDeviceBuilder& VulkanDeviceBuilder::OptionalDescriptorIndexing()
 	return *this;
 }
 
+VulkanDeviceBuilder& VulkanDeviceBuilder::OptionalDynamicRendering()
+{
+	OptionalExtension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+	OptionalExtension(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+	OptionalExtension(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+	OptionalExtension(VK_KHR_MULTIVIEW_EXTENSION_NAME);
+	OptionalExtension(VK_KHR_MAINTENANCE2_EXTENSION_NAME);
+	return *this;
+}
+
+VulkanDeviceBuilder& VulkanDeviceBuilder::OptionalHostImageCopy()
+{
+	OptionalExtension(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME);
+	OptionalExtension(VK_KHR_COPY_COMMANDS_2_EXTENSION_NAME);
+	OptionalExtension(VK_KHR_FORMAT_FEATURE_FLAGS_2_EXTENSION_NAME);
+	return *this;
+}
+
+VulkanDeviceBuilder& VulkanDeviceBuilder::OptionalPresentWait()
+{
+	OptionalExtension(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+	OptionalExtension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+	return *this;
+}
+
 VulkanDeviceBuilder& VulkanDeviceBuilder::Surface(std::shared_ptr<VulkanSurface> surface)
 {
 	if (surface)
@@ -1780,6 +1879,10 @@ std::vector<VulkanCompatibleDevice> VulkanDeviceBuilder::FindDevices(const std::
 		enabledFeatures.DescriptorIndexing.descriptorBindingSampledImageUpdateAfterBind = deviceFeatures.DescriptorIndexing.descriptorBindingSampledImageUpdateAfterBind;
 		enabledFeatures.DescriptorIndexing.descriptorBindingVariableDescriptorCount = deviceFeatures.DescriptorIndexing.descriptorBindingVariableDescriptorCount;
 		enabledFeatures.DescriptorIndexing.shaderSampledImageArrayNonUniformIndexing = deviceFeatures.DescriptorIndexing.shaderSampledImageArrayNonUniformIndexing;
+		enabledFeatures.DynamicRendering.dynamicRendering = deviceFeatures.DynamicRendering.dynamicRendering;
+		enabledFeatures.HostImageCopy.hostImageCopy = deviceFeatures.HostImageCopy.hostImageCopy;
+		enabledFeatures.PresentId.presentId = deviceFeatures.PresentId.presentId;
+		enabledFeatures.PresentWait.presentWait = deviceFeatures.PresentWait.presentWait;
 
 		// Figure out which queue can present
 		if (surface)
@@ -137,6 +137,26 @@ void VulkanDevice::CreateDevice()
 		*next = &EnabledFeatures.DescriptorIndexing;
 		next = &EnabledFeatures.DescriptorIndexing.pNext;
 	}
+	if (SupportsExtension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+	{
+		*next = &EnabledFeatures.DynamicRendering;
+		next = &EnabledFeatures.DynamicRendering.pNext;
+	}
+	if (SupportsExtension(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME))
+	{
+		*next = &EnabledFeatures.HostImageCopy;
+		next = &EnabledFeatures.HostImageCopy.pNext;
+	}
+	if (SupportsExtension(VK_KHR_PRESENT_ID_EXTENSION_NAME))
+	{
+		*next = &EnabledFeatures.PresentId;
+		next = &EnabledFeatures.PresentId.pNext;
+	}
+	if (SupportsExtension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+	{
+		*next = &EnabledFeatures.PresentWait;
+		next = &EnabledFeatures.PresentWait.pNext;
+	}
 
 	VkResult result = vkCreateDevice(PhysicalDevice.Device, &deviceCreateInfo, nullptr, &device);
 	CheckVulkanError(result, "Could not create vulkan device");
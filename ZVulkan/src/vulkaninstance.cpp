@@ -297,6 +297,26 @@ std::vector<VulkanPhysicalDevice> VulkanInstance::GetPhysicalDevices(VkInstance
 				*next = &dev.Features.DescriptorIndexing;
 				next = &dev.Features.DescriptorIndexing.pNext;
 			}
+			if (checkForExtension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+			{
+				*next = &dev.Features.DynamicRendering;
+				next = &dev.Features.DynamicRendering.pNext;
+			}
+			if (checkForExtension(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME))
+			{
+				*next = &dev.Features.HostImageCopy;
+				next = &dev.Features.HostImageCopy.pNext;
+			}
+			if (checkForExtension(VK_KHR_PRESENT_ID_EXTENSION_NAME))
+			{
+				*next = &dev.Features.PresentId;
+				next = &dev.Features.PresentId.pNext;
+			}
+			if (checkForExtension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+			{
+				*next = &dev.Features.PresentWait;
+				next = &dev.Features.PresentWait.pNext;
+			}
 
 			vkGetPhysicalDeviceFeatures2(dev.Device, &deviceFeatures2);
 			dev.Features.Features = deviceFeatures2.features;
@@ -304,6 +324,10 @@ std::vector<VulkanPhysicalDevice> VulkanInstance::GetPhysicalDevices(VkInstance
 			dev.Features.AccelerationStructure.pNext = nullptr;
 			dev.Features.RayQuery.pNext = nullptr;
 			dev.Features.DescriptorIndexing.pNext = nullptr;
+			dev.Features.DynamicRendering.pNext = nullptr;
+			dev.Features.HostImageCopy.pNext = nullptr;
+			dev.Features.PresentId.pNext = nullptr;
+			dev.Features.PresentWait.pNext = nullptr;
 		}
 		else
 		{
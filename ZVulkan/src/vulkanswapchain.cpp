@@ -248,9 +248,12 @@ int VulkanSwapChain::AcquireImage(VulkanSemaphore* semaphore, VulkanFence* fence
 	}
 }
 
-void VulkanSwapChain::QueuePresent(int imageIndex, VulkanSemaphore* semaphore)
+void VulkanSwapChain::QueuePresent(int imageIndex, VulkanSemaphore* semaphore, uint64_t presentId)
 {
 	uint32_t index = imageIndex;
+	VkPresentIdKHR presentIdInfo = { VK_STRUCTURE_TYPE_PRESENT_ID_KHR };
+	presentIdInfo.swapchainCount = 1;
+	presentIdInfo.pPresentIds = &presentId;
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.waitSemaphoreCount = semaphore ? 1 : 0;
@@ -259,6 +262,8 @@ void VulkanSwapChain::QueuePresent(int imageIndex, VulkanSemaphore* semaphore)
 	presentInfo.pSwapchains = &swapchain;
 	presentInfo.pImageIndices = &index;
 	presentInfo.pResults = nullptr;
+	if (presentId != 0)
+		presentInfo.pNext = &presentIdInfo;
 	VkResult result = vkQueuePresentKHR(device->PresentQueue, &presentInfo);
 	if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
 	{
@@ -285,6 +290,32 @@ void VulkanSwapChain::QueuePresent(int imageIndex, VulkanSemaphore* semaphore)
 	}
 }
 
+bool VulkanSwapChain::WaitForPresent(uint64_t presentId, uint64_t timeout)
+{
+	if (lost)
+		return false;
+
+	VkResult result = vkWaitForPresentKHR(device->device, swapchain, presentId, timeout);
+	if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+	{
+		return true;
+	}
+	else if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_ERROR_SURFACE_LOST_KHR || result == VK_ERROR_FULL_SCREEN_EXCLUSIVE_MODE_LOST_EXT)
+	{
+		lost = true;
+		return false;
+	}
+	else if (result == VK_TIMEOUT)
+	{
+		return false;
+	}
+	else
+	{
+		VulkanError("vkWaitForPresentKHR failed");
+		return false;
+	}
+}
+
 VulkanSurfaceCapabilities VulkanSwapChain::GetSurfaceCapabilities(bool exclusivefullscreen)
 {
 	// They sure made it easy to query something that isn't even time critical. Good job guys!